@@ -0,0 +1,116 @@
+const path = require('path')
+const fs = require('fs-extra')
+const config = require('../lib/config')
+const util = require('../lib/util')
+const BuildGraph = require('./buildGraph')
+
+const testFileRegex = /_(unit|browser|api)?tests?\.(cc|mm)$/
+// Changes to these files never affect test results.
+const ignoredFileRegex = /(\.md|^\/\/brave\/\.github\/.*|^\/\/brave\/(CODEOWNERS|LICENSE))$/
+const testMacroRegex = /^\s*(TEST|TEST_F|TEST_P|TYPED_TEST|TYPED_TEST_P|IN_PROC_BROWSER_TEST_F|IN_PROC_BROWSER_TEST_P)\(\s*(\w+)\s*,/gm
+
+// Files changed in brave-core relative to the merge base with |base|,
+// including uncommitted changes, as source-absolute paths.
+const getChangedFiles = (base) => {
+  const options = Object.assign({}, config.defaultOptions, {
+    cwd: config.projects['brave-core'].dir,
+    stdio: 'pipe'
+  })
+  const files = new Set()
+  for (const args of [['diff', '--name-only', base + '...HEAD'], ['diff', '--name-only', 'HEAD']]) {
+    util.run('git', args, options).stdout.toString().split(/\r?\n/)
+      .filter((file) => file)
+      .forEach((file) => files.add('//brave/' + file))
+  }
+  return [...files]
+}
+
+// Returns gtest filter patterns for the fixtures defined in |contents|.
+const fixtureFilters = (contents) => {
+  const filters = new Set()
+  let match
+  testMacroRegex.lastIndex = 0
+  while ((match = testMacroRegex.exec(contents)) !== null) {
+    const [, macro, fixture] = match
+    // Parameterized tests are instantiated as <prefix>/<fixture>.<test>/<n>.
+    filters.add(macro.endsWith('_P') ? `*/${fixture}.*` : `${fixture}.*`)
+  }
+  return [...filters]
+}
+
+const readFixtureFilters = (file) => {
+  const fullPath = path.join(config.srcDir, file.substring(2))
+  return fs.existsSync(fullPath) ? fixtureFilters(fs.readFileSync(fullPath, 'utf8')) : []
+}
+
+// Test sources of |suiteFiles| which most likely cover |file|, e.g.
+// foo_unittest.cc and foo_browsertest.cc for foo.cc or foo.h.
+const siblingTestFiles = (file, suiteFiles) => {
+  const stem = file.replace(/\.[^./]+$/, '')
+  return suiteFiles.filter((suiteFile) => suiteFile.startsWith(stem + '_') && testFileRegex.test(suiteFile))
+}
+
+// Works out whether |suite| is affected by the brave-core changes since
+// |base| and, when possible, which gtest fixtures cover them. |filter| is
+// null when the whole suite has to run.
+const affectedTests = (suite, base = 'origin/master') => {
+  const buildGraph = new BuildGraph(config.outputDir)
+  if (!fs.existsSync(path.join(config.outputDir, 'build.ninja.d'))) {
+    console.error(`--affected needs a generated out dir, run \`npm run build\` for ${config.outputDir} first`)
+    process.exit(1)
+  }
+  buildGraph.update()
+
+  const suiteLabel = Object.keys(buildGraph.read('meta').tests)
+    .find((label) => label.endsWith(':' + suite))
+  if (!suiteLabel) {
+    console.warn(`${suite} is not in the build graph, running all of it`)
+    return { affected: true, filter: null }
+  }
+  const suiteTargets = buildGraph.closure([suiteLabel], true)
+  const targets = buildGraph.read('targets')
+  const suiteFiles = [...suiteTargets]
+    .reduce((files, label) => files.concat((targets[label] || { files: [] }).files), [])
+
+  let affected = false
+  let narrowable = true
+  const filters = new Set()
+  for (const file of getChangedFiles(base)) {
+    if (ignoredFileRegex.test(file)) {
+      continue
+    }
+    let labels = buildGraph.targetsForFile(file)
+    if (path.basename(file) === 'BUILD.gn') {
+      const dir = path.dirname(file)
+      labels = Object.keys(targets).filter((label) => BuildGraph.labelDir(label) === dir)
+    }
+    if (!labels.length) {
+      // Patches, .gni files, resources outside the graph, ... can affect
+      // anything.
+      console.log(`${file} is not in the build graph, assuming it affects ${suite}`)
+      affected = true
+      narrowable = false
+      continue
+    }
+    if (!labels.some((label) => suiteTargets.has(label))) {
+      continue
+    }
+    affected = true
+    const testFiles = testFileRegex.test(file) ? [file] : siblingTestFiles(file, suiteFiles)
+    const fileFilters = testFiles.reduce((all, testFile) => all.concat(readFixtureFilters(testFile)), [])
+    if (!fileFilters.length) {
+      narrowable = false
+    }
+    fileFilters.forEach((filter) => filters.add(filter))
+  }
+
+  return {
+    affected,
+    filter: affected && narrowable ? [...filters].sort().join(':') : null
+  }
+}
+
+module.exports = Object.assign(affectedTests, {
+  fixtureFilters,
+  siblingTestFiles
+})
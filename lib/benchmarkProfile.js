@@ -0,0 +1,133 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Profiles, pages and tools shared by the benchmark, soak, profiling and
+// profile guided optimization commands.
+
+const path = require('path')
+const os = require('os')
+const fs = require('fs-extra')
+const { spawnSync } = require('child_process')
+const ReplayServer = require('./replayServer')
+
+const pageTimeoutMs = 60000
+const syntheticPageCount = 8
+
+const mergePreferences = (target, source) => {
+  for (const [key, value] of Object.entries(source)) {
+    if (value && typeof value === 'object' && !Array.isArray(value) &&
+        target[key] && typeof target[key] === 'object') {
+      mergePreferences(target[key], value)
+    } else {
+      target[key] = value
+    }
+  }
+  return target
+}
+
+// Writes |preferences| into the Default profile of |userDataDir|, on top of
+// those of a seed profile.
+const writePreferences = (userDataDir, preferences) => {
+  const file = path.join(userDataDir, 'Default', 'Preferences')
+  const existing = fs.existsSync(file) ? fs.readJsonSync(file) : {}
+  fs.outputJsonSync(file, mergePreferences(existing, preferences))
+}
+
+// Writes a corpus of |count| small sites to |dir|, for runs without a page
+// corpus. Each page builds a list and keeps polling an API with a bounded
+// cache, so its own memory use is flat.
+const syntheticCorpus = (dir, count) => {
+  const pages = []
+  const responses = []
+  const add = (url, contentType, body) => {
+    const bodyFile = path.join('bodies', `${responses.length}`)
+    fs.outputFileSync(path.join(dir, bodyFile), body)
+    responses.push({ method: 'GET', url, status: 200, headers: { 'content-type': contentType }, body: bodyFile })
+  }
+  for (let i = 0; i < count; i++) {
+    const origin = `https://soak${i}.test`
+    pages.push(`${origin}/`)
+    add(`${origin}/`, 'text/html', `<!doctype html>
+<html><head><title>Soak ${i}</title><link rel="stylesheet" href="/style.css"></head>
+<body><h1>Soak ${i}</h1><ul id="items"></ul><script src="/app.js"></script></body></html>`)
+    add(`${origin}/style.css`, 'text/css', 'body { font-family: sans-serif } li { padding: 2px }')
+    add(`${origin}/app.js`, 'application/javascript', `const list = document.getElementById('items')
+for (let i = 0; i < 500; i++) {
+  const item = document.createElement('li')
+  item.textContent = 'item ' + i
+  list.appendChild(item)
+}
+const cache = []
+setInterval(() => fetch('/api?t=' + Date.now()).then((response) => response.json()).then((data) => {
+  cache.push(data)
+  if (cache.length > 100) {
+    cache.shift()
+  }
+  list.firstChild.textContent = 'updated ' + data.items.length
+}).catch(() => {}), 2000)`)
+    add(`${origin}/api`, 'application/json', JSON.stringify({ items: Array.from({ length: 200 }, (v, n) => ({ id: n, name: `item ${n}` })) }))
+  }
+  fs.writeJsonSync(path.join(dir, 'corpus.json'), { pages, responses })
+}
+
+// Starts a replay server of the page corpus in |corpusDir|, or of synthetic
+// pages when there is none (no --page_corpus), and stops it again once the
+// promise of |fn(server)| settles. |serverOptions| go to the ReplayServer.
+const withReplayServer = async (corpusDir, fn, serverOptions = {}) => {
+  let syntheticDir
+  if (!corpusDir) {
+    syntheticDir = fs.mkdtempSync(path.join(os.tmpdir(), 'brave-synthetic-corpus-'))
+    corpusDir = syntheticDir
+    syntheticCorpus(corpusDir, syntheticPageCount)
+  }
+  try {
+    const server = new ReplayServer(corpusDir, serverOptions)
+    await server.start()
+    try {
+      return await fn(server)
+    } finally {
+      await server.stop()
+    }
+  } finally {
+    if (syntheticDir) {
+      fs.removeSync(syntheticDir)
+    }
+  }
+}
+
+// Navigates the tab of |sessionId| to |url| and waits for its load event.
+const navigate = async (devtools, sessionId, url) => {
+  const loaded = devtools.waitForEvent('Page.loadEventFired', sessionId, pageTimeoutMs)
+  const navigation = await devtools.send('Page.navigate', { url }, sessionId)
+  return !navigation.errorText && !!await loaded
+}
+
+const openTab = async (devtools, url) => {
+  const { targetId } = await devtools.send('Target.createTarget', { url: 'about:blank' })
+  const { sessionId } = await devtools.send('Target.attachToTarget', { targetId, flatten: true })
+  await devtools.send('Page.enable', {}, sessionId)
+  const loaded = await navigate(devtools, sessionId, url)
+  return { targetId, sessionId, loaded }
+}
+
+// Whether a build with |buildArgs| keeps frame pointers (enable_profiling,
+// which debug builds set, turns them on).
+const hasFramePointers = (buildArgs) =>
+  !!(buildArgs.enable_profiling || buildArgs.enable_frame_pointers || buildArgs.is_debug)
+
+// Whether perf can record last branch records here. They need hardware
+// support, which virtual machines often lack.
+const lbrSupported = () =>
+  spawnSync('perf', ['record', '-e', 'cycles:u', '-j', 'any,u', '-o', '/dev/null', '--', 'true']).status === 0
+
+module.exports = {
+  writePreferences,
+  syntheticCorpus,
+  withReplayServer,
+  navigate,
+  openTab,
+  hasFramePointers,
+  lbrSupported
+}
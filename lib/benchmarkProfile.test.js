@@ -0,0 +1,34 @@
+const path = require('path')
+const os = require('os')
+const http = require('http')
+const fs = require('fs-extra')
+const { writePreferences, withReplayServer } = require('./benchmarkProfile')
+
+test('writes preferences on top of those of a seed profile', function () {
+  const userDataDir = fs.mkdtempSync(path.join(os.tmpdir(), 'benchmark-profile-'))
+  try {
+    const file = path.join(userDataDir, 'Default', 'Preferences')
+    fs.outputJsonSync(file, { brave: { shields: { stats: 1 } }, profile: { name: 'seed' } })
+    writePreferences(userDataDir, { brave: { rewards: { enabled: true } }, profile: { name: 'bench' } })
+    expect(fs.readJsonSync(file)).toEqual({
+      brave: { shields: { stats: 1 }, rewards: { enabled: true } },
+      profile: { name: 'bench' }
+    })
+  } finally {
+    fs.removeSync(userDataDir)
+  }
+})
+
+test('serves synthetic pages without a page corpus', async function () {
+  let corpusDir
+  const status = await withReplayServer(undefined, (server) => new Promise((resolve, reject) => {
+    corpusDir = server.archive.dir
+    expect(server.archive.pages.length).toBe(8)
+    http.get({ host: '127.0.0.1', port: server.port, path: server.archive.pages[0] + 'app.js' }, (res) => {
+      res.resume()
+      resolve(res.statusCode)
+    }).on('error', reject)
+  }))
+  expect(status).toBe(200)
+  expect(fs.existsSync(corpusDir)).toBe(false)
+})
@@ -0,0 +1,143 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Percentile of sorted |values|, interpolating between closest ranks.
+const percentile = (sorted, p) => {
+  if (!sorted.length) {
+    return null
+  }
+  const rank = (sorted.length - 1) * p / 100
+  const lower = Math.floor(rank)
+  const upper = Math.ceil(rank)
+  return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - lower)
+}
+
+const numbers = (samples) => samples.filter((value) => typeof value === 'number' && !isNaN(value))
+
+const round = (value) => value === null ? null : Math.round(value * 100) / 100
+
+// Summary of benchmark samples, e.g. durations in ms.
+const summarize = (samples) => {
+  const sorted = numbers(samples).sort((a, b) => a - b)
+  const mean = sorted.length ? sorted.reduce((sum, value) => sum + value, 0) / sorted.length : null
+  return {
+    samples: sorted.length,
+    min: round(sorted.length ? sorted[0] : null),
+    mean: round(mean),
+    p50: round(percentile(sorted, 50)),
+    p90: round(percentile(sorted, 90)),
+    p95: round(percentile(sorted, 95)),
+    max: round(sorted.length ? sorted[sorted.length - 1] : null)
+  }
+}
+
+// Two-sided 95% critical values of Student's t distribution for 1 to 30
+// degrees of freedom.
+const t95 = [12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+  2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+  2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042]
+
+// Higher degrees of freedom, from t(30), t(40), t(60), t(120) and t(1000):
+// the value of the largest tabled df at or below the actual one.
+const t95Above30 = [[1000, 1.962], [120, 1.980], [60, 2.000], [40, 2.021], [30, 2.042]]
+
+// Rounds degrees of freedom down, fractional ones and those between tabled
+// values, which widens the interval.
+const tCritical = (df) => {
+  df = Math.floor(df)
+  if (df < 1) {
+    return null
+  }
+  if (df <= 30) {
+    return t95[df - 1]
+  }
+  return t95Above30.find(([tabled]) => df >= tabled)[1]
+}
+
+const variance = (values, mean) =>
+  values.reduce((sum, value) => sum + (value - mean) * (value - mean), 0) / (values.length - 1)
+
+// 95% confidence interval of the mean of |samples|: { mean, low, high }.
+// The bounds are null with fewer than two samples.
+const confidenceInterval = (samples) => {
+  const values = numbers(samples)
+  if (!values.length) {
+    return { mean: null, low: null, high: null }
+  }
+  const mean = values.reduce((sum, value) => sum + value, 0) / values.length
+  if (values.length < 2) {
+    return { mean: round(mean), low: null, high: null }
+  }
+  const halfWidth = tCritical(values.length - 1) * Math.sqrt(variance(values, mean) / values.length)
+  return { mean: round(mean), low: round(mean - halfWidth), high: round(mean + halfWidth) }
+}
+
+// 95% confidence interval of mean(|b|) - mean(|a|) (Welch's t interval, which
+// does not assume both have the same variance). |significant| is whether the
+// interval excludes 0.
+const differenceInterval = (a, b) => {
+  const x = numbers(a)
+  const y = numbers(b)
+  if (!x.length || !y.length) {
+    return { mean: null, low: null, high: null, significant: false }
+  }
+  const meanX = x.reduce((sum, value) => sum + value, 0) / x.length
+  const meanY = y.reduce((sum, value) => sum + value, 0) / y.length
+  const mean = meanY - meanX
+  if (x.length < 2 || y.length < 2) {
+    return { mean: round(mean), low: null, high: null, significant: false }
+  }
+  const seX = variance(x, meanX) / x.length
+  const seY = variance(y, meanY) / y.length
+  const se = Math.sqrt(seX + seY)
+  if (se === 0) {
+    return { mean: round(mean), low: round(mean), high: round(mean), significant: mean !== 0 }
+  }
+  const df = (seX + seY) * (seX + seY) /
+    (seX * seX / (x.length - 1) + seY * seY / (y.length - 1))
+  const halfWidth = tCritical(df) * se
+  return {
+    mean: round(mean),
+    low: round(mean - halfWidth),
+    high: round(mean + halfWidth),
+    significant: mean - halfWidth > 0 || mean + halfWidth < 0
+  }
+}
+
+// Least squares line through |points| ([x, y] pairs):
+// { slope, intercept, r2 }, null with fewer than two distinct x.
+const linearRegression = (points) => {
+  const n = points.length
+  if (n < 2) {
+    return null
+  }
+  const meanX = points.reduce((sum, [x]) => sum + x, 0) / n
+  const meanY = points.reduce((sum, [, y]) => sum + y, 0) / n
+  let sxx = 0
+  let sxy = 0
+  let syy = 0
+  for (const [x, y] of points) {
+    sxx += (x - meanX) * (x - meanX)
+    sxy += (x - meanX) * (y - meanY)
+    syy += (y - meanY) * (y - meanY)
+  }
+  if (sxx === 0) {
+    return null
+  }
+  const slope = sxy / sxx
+  return {
+    slope: round(slope),
+    intercept: round(meanY - slope * meanX),
+    r2: syy === 0 ? 1 : round(sxy * sxy / (sxx * syy))
+  }
+}
+
+module.exports = {
+  percentile,
+  summarize,
+  confidenceInterval,
+  differenceInterval,
+  linearRegression
+}
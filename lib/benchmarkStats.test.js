@@ -0,0 +1,36 @@
+const { confidenceInterval, differenceInterval, linearRegression } = require('./benchmarkStats')
+
+test('computes the 95% confidence interval of a mean', function () {
+  // Standard error sqrt(200 / 3 / 4), t = 3.182 for 3 degrees of freedom.
+  expect(confidenceInterval([10, 20, 30, 20, null])).toEqual({ mean: 20, low: 7.01, high: 32.99 })
+  expect(confidenceInterval([5])).toEqual({ mean: 5, low: null, high: null })
+  expect(confidenceInterval([])).toEqual({ mean: null, low: null, high: null })
+})
+
+test('uses t(30) between 30 and 40 degrees of freedom', function () {
+  // Standard error sqrt(1 / 35), t = 2.042 rather than t(40) = 2.021.
+  const samples = new Array(18).fill(0).concat(new Array(18).fill(2))
+  expect(confidenceInterval(samples)).toEqual({ mean: 1, low: 0.65, high: 1.35 })
+})
+
+test('computes the confidence interval of a difference of means', function () {
+  const slower = differenceInterval([100, 102, 98, 100], [120, 121, 119, 120])
+  expect(slower.mean).toBe(20)
+  expect(slower.significant).toBe(true)
+  expect(slower.low).toBeGreaterThan(15)
+  expect(slower.high).toBeLessThan(25)
+
+  const noise = differenceInterval([100, 130, 70, 100], [105, 135, 75, 105])
+  expect(noise.mean).toBe(5)
+  expect(noise.significant).toBe(false)
+  expect(noise.low).toBeLessThan(0)
+})
+
+test('fits a line through samples over time', function () {
+  expect(linearRegression([[0, 100], [1, 110], [2, 120], [3, 130]]))
+    .toEqual({ slope: 10, intercept: 100, r2: 1 })
+  const noisy = linearRegression([[0, 100], [1, 95], [2, 104], [3, 99]])
+  expect(Math.abs(noisy.slope)).toBeLessThan(2)
+  expect(noisy.r2).toBeLessThan(0.5)
+  expect(linearRegression([[1, 100]])).toBe(null)
+})
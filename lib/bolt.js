@@ -0,0 +1,223 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const os = require('os')
+const fs = require('fs-extra')
+const { spawnSync } = require('child_process')
+const config = require('../lib/config')
+const util = require('../lib/util')
+const calculateFileChecksum = require('./calculateFileChecksum')
+const { measureStartup, withBenchmarkEnvironment } = require('./startupBenchmark')
+const { loadPages } = require('./pageLoadBenchmark')
+const { withReplayServer, lbrSupported } = require('./benchmarkProfile')
+const { summarize, differenceInterval } = require('./benchmarkStats')
+
+const defaultRuns = 5
+// Options of llvm-bolt for large binaries with a profile of the whole
+// program: hot blocks and functions laid out together, cold code split off.
+// The DWARF of brave.bolt is rewritten for the new layout, so symbols for
+// crash reports are dumped from the optimized binary.
+const boltOptions = ['-reorder-blocks=cache+', '-reorder-functions=hfsort+', '-split-functions=3',
+  '-split-all-cold', '-split-eh', '-icf=1', '-use-gnu-stack', '-update-debug-sections', '-dyno-stats']
+
+const boltTool = (name) => config.boltDir ? path.join(config.boltDir, name) : name
+
+const paths = () => {
+  const binary = path.join(config.outputDir, 'brave')
+  const boltDir = path.join(config.outputDir, 'bolt')
+  return {
+    // The binary as linked. It stays a plain ninja output, which later
+    // builds, `start` and create_dist without --bolt use.
+    binary,
+    optimized: binary + '.bolt',
+    instrumented: binary + '.bolt_instrumented',
+    dir: boltDir,
+    profile: path.join(boltDir, 'profile.fdata'),
+    state: path.join(boltDir, 'state.json'),
+    report: path.join(boltDir, 'bolt-report.json')
+  }
+}
+
+const runTool = (name, args) => util.run(boltTool(name), args, config.defaultOptions)
+
+// Without the relocations of --emit-relocs BOLT cannot move functions and
+// only lays out the blocks within them.
+const hasRelocations = (binary) => {
+  const readelf = spawnSync('readelf', ['-S', '--wide', binary], { encoding: 'utf8', maxBuffer: 16 * 1024 * 1024 })
+  return readelf.status === 0 && readelf.stdout.includes('.rela.text')
+}
+
+// The standard workload: a startup and loading |pages| from the replay
+// |server|, through |launcher|, which gets the browser arguments and returns
+// the command and arguments to launch.
+const runWorkload = async (launcher, pages, server) => {
+  await withBenchmarkEnvironment(server.browserArgs(), async (benchArgs, env) => {
+    const [binary, args] = launcher(benchArgs)
+    await loadPages(binary, args, env, pages, {}, {})
+  })
+}
+
+// Collects a profile of the workload on the binary as linked into
+// |profile|: sampled with last branch records under perf where the CPU has
+// them, with a BOLT instrumented copy of the binary otherwise.
+const collectProfile = async (p, pages, server) => {
+  const rawDir = fs.mkdtempSync(path.join(os.tmpdir(), 'brave-bolt-'))
+  try {
+    let profiles
+    if (lbrSupported()) {
+      console.log('Profiling the workload with last branch records...')
+      const perfData = path.join(rawDir, 'perf.data')
+      await runWorkload((args) => ['perf',
+        ['record', '-e', 'cycles:u', '-j', 'any,u', '-o', perfData, '--', p.binary, ...args]], pages, server)
+      runTool('perf2bolt', ['-p', perfData, '-o', path.join(rawDir, 'perf.fdata'), p.binary])
+      profiles = [path.join(rawDir, 'perf.fdata')]
+    } else {
+      console.log('No last branch records on this CPU, profiling the workload with an instrumented binary...')
+      runTool('llvm-bolt', [p.binary, '-instrument', '-instrumentation-file=' + path.join(rawDir, 'prof.fdata'),
+        '-instrumentation-file-append-pid', '-o', p.instrumented])
+      try {
+        // The sandbox would keep child processes from writing their profiles.
+        await runWorkload((args) => [p.instrumented, args.concat('--no-sandbox')], pages, server)
+      } finally {
+        fs.removeSync(p.instrumented)
+      }
+      profiles = fs.readdirSync(rawDir).filter((file) => file.startsWith('prof.fdata'))
+        .map((file) => path.join(rawDir, file))
+    }
+    if (!profiles.length) {
+      throw new Error('The workload wrote no BOLT profile')
+    }
+    // merge-fdata writes the merged profile to stdout.
+    const output = fs.openSync(p.profile, 'w')
+    try {
+      const merge = spawnSync(boltTool('merge-fdata'), profiles, { stdio: ['ignore', output, 'inherit'] })
+      if (merge.error || merge.status !== 0) {
+        throw new Error('merge-fdata failed' + (merge.error ? `: ${merge.error.message}` : ''))
+      }
+    } finally {
+      fs.closeSync(output)
+    }
+  } finally {
+    fs.removeSync(rawDir)
+  }
+}
+
+// Time to first paint and mean page load time of |binaries| over |runs|,
+// alternating which binary goes first.
+const benchmark = async (binaries, runs, pages, server) => {
+  const samples = {}
+  for (const name of Object.keys(binaries)) {
+    samples[name] = { first_paint: [], load_ms: [] }
+  }
+  await withBenchmarkEnvironment(server.browserArgs(), async (benchArgs, env) => {
+    for (let run = 1; run <= runs; run++) {
+      const names = Object.keys(binaries)
+      for (const name of run % 2 ? names : names.reverse()) {
+        const startup = await measureStartup(binaries[name], benchArgs, null, env)
+        samples[name].first_paint.push(startup && startup.first_paint)
+        const loads = Object.values(await loadPages(binaries[name], benchArgs, env, pages, {}, {}))
+          .filter((metrics) => metrics).map((metrics) => metrics.load_ms)
+        samples[name].load_ms.push(loads.length ? loads.reduce((sum, value) => sum + value, 0) / loads.length : null)
+        console.log(`run ${run}/${runs} ${name}: first paint ${startup && startup.first_paint}ms, ` +
+          `${loads.length}/${pages.length} pages loaded`)
+      }
+    }
+  })
+  return samples
+}
+
+const optimize = async (p) => {
+  runTool('llvm-bolt', [p.binary, '-data=' + p.profile, '-o', p.optimized, ...boltOptions])
+  fs.writeJsonSync(p.state, {
+    linked_sha256: await calculateFileChecksum(p.binary),
+    optimized_sha256: await calculateFileChecksum(p.optimized),
+    created: new Date().toISOString()
+  }, { spaces: 2 })
+}
+
+// The post-link stage of `build --bolt`: profiles the linked brave on the
+// standard workload, writes the BOLT optimized binary to brave.bolt, which
+// `create_dist --bolt` packages, and reports the startup and page load times
+// of both. Linux only.
+const bolt = async (options) => {
+  if (process.platform !== 'linux') {
+    throw new Error('BOLT is only supported for Linux builds')
+  }
+  const p = paths()
+  fs.ensureDirSync(p.dir)
+  if (!hasRelocations(p.binary)) {
+    console.log('brave was linked without --emit-relocs, BOLT can only lay out the blocks within functions')
+  }
+
+  const runs = parseInt(options.bolt_runs, 10) || defaultRuns
+  await withReplayServer(options.page_corpus, async (server) => {
+    const pages = server.archive.pages
+    await collectProfile(p, pages, server)
+    console.log('Optimizing brave with BOLT...')
+    await optimize(p)
+    const samples = await benchmark({ linked: p.binary, bolt: p.optimized }, runs, pages, server)
+    const report = { binary: p.binary, optimized: p.optimized, profile: p.profile, runs, metrics: {} }
+    for (const metric of Object.keys(samples.linked)) {
+      report.metrics[metric] = {
+        linked: summarize(samples.linked[metric]),
+        bolt: summarize(samples.bolt[metric]),
+        change: differenceInterval(samples.linked[metric], samples.bolt[metric])
+      }
+    }
+    fs.writeJsonSync(p.report, report, { spaces: 2 })
+    for (const [metric, { linked, bolt, change }] of Object.entries(report.metrics)) {
+      console.log(`${metric}: p50 ${linked.p50}ms -> ${bolt.p50}ms, mean change ${change.mean}ms ` +
+        `[${change.low}, ${change.high}]${change.significant ? '' : ' (not significant)'}`)
+    }
+    console.log(`BOLT report written to ${p.report}`)
+  })
+}
+
+// Checks before `create_dist --bolt` that brave.bolt is the optimized brave
+// as it is linked now. A brave linked again since `build --bolt` has no
+// benchmark of its BOLT run, so it is refused rather than optimized with the
+// old profile.
+const ensureOptimized = async () => {
+  const p = paths()
+  if (!fs.existsSync(p.optimized) || !fs.existsSync(p.state)) {
+    throw new Error(`There is no ${p.optimized}, build with --bolt first`)
+  }
+  util.buildTarget()
+  const state = fs.readJsonSync(p.state)
+  if (await calculateFileChecksum(p.binary) !== state.linked_sha256 ||
+      await calculateFileChecksum(p.optimized) !== state.optimized_sha256) {
+    throw new Error('brave was linked again since its BOLT run, build with --bolt to optimize and benchmark it')
+  }
+}
+
+// Runs |fn|, e.g. the create_dist build, with brave.bolt in place of brave.
+// The packaging steps run again since brave is then newer than their
+// outputs, while brave itself is not linked again. The linked brave is put
+// back afterwards, also if |fn| exits the process, with a new mtime, so that
+// the next create_dist without --bolt packages it again.
+const withOptimizedBinary = (fn) => {
+  const p = paths()
+  const linked = p.binary + '.linked'
+  fs.renameSync(p.binary, linked)
+  const restore = () => {
+    fs.removeSync(p.binary)
+    fs.renameSync(linked, p.binary)
+    const now = new Date()
+    fs.utimesSync(p.binary, now, now)
+  }
+  process.once('exit', restore)
+  try {
+    fs.copySync(p.optimized, p.binary)
+    return fn()
+  } finally {
+    process.removeListener('exit', restore)
+    restore()
+  }
+}
+
+module.exports = bolt
+module.exports.ensureOptimized = ensureOptimized
+module.exports.withOptimizedBinary = withOptimizedBinary
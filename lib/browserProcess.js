@@ -0,0 +1,65 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const { spawn, spawnSync } = require('child_process')
+
+const pollIntervalMs = 500
+// How long the browser gets to quit before it is killed.
+const shutdownGraceMs = 15000
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms))
+
+// A browser run by the benchmark and audit modes of `start`, which watch it
+// while it runs and then quit it themselves.
+class BrowserProcess {
+  constructor (binary, args, options = {}) {
+    this.logPrefix = options.logPrefix || ''
+    this.exited = false
+    this.startTime = Date.now()
+    this.prog = spawn(binary, args, { stdio: options.stdio || 'inherit', env: options.env })
+    this.prog.on('exit', () => { this.exited = true })
+    this.prog.on('error', (e) => {
+      console.log(`${this.logPrefix}Could not start ${binary}: ${e.message}`)
+      this.exited = true
+    })
+  }
+
+  get pid () {
+    return this.prog.pid
+  }
+
+  async waitForExit (timeoutMs) {
+    const deadline = Date.now() + timeoutMs
+    while (!this.exited && Date.now() < deadline) {
+      await sleep(pollIntervalMs)
+    }
+    return this.exited
+  }
+
+  // Asks the browser to quit so it completes its logs and traces, and kills
+  // it if it does not exit in time.
+  async stop () {
+    const gracefulKill = () => process.platform === 'win32'
+      ? spawnSync('taskkill', ['/PID', String(this.prog.pid), '/T'])
+      : this.prog.kill('SIGTERM')
+    const forcedKill = () => process.platform === 'win32'
+      ? spawnSync('taskkill', ['/PID', String(this.prog.pid), '/T', '/F'])
+      : this.prog.kill('SIGKILL')
+    for (const kill of [gracefulKill, forcedKill]) {
+      if (this.exited) {
+        return
+      }
+      kill()
+      if (await this.waitForExit(shutdownGraceMs)) {
+        return
+      }
+      console.log(this.logPrefix + 'Brave did not quit in time, killing it')
+    }
+  }
+}
+
+module.exports = BrowserProcess
+module.exports.sleep = sleep
+module.exports.pollIntervalMs = pollIntervalMs
@@ -1,7 +1,15 @@
 const config = require('../lib/config')
 const util = require('../lib/util')
 const path = require('path')
+const assert = require('assert')
+const os = require('os')
+const readline = require('readline')
+const { spawn } = require('child_process')
 const fs = require('fs-extra')
+const JobServer = require('./jobServer')
+const buildExecutors = require('./buildExecutors')
+const compareExecutors = require('./compareExecutors')
+const bolt = require('./bolt')
 
 const touchOverriddenFiles = () => {
   console.log('touch original files overridden by chromium_src...')
@@ -70,6 +78,14 @@ const touchOverriddenVectorIconFiles = () => {
   })
 }
 
+// Brings the files of the source tree which the build does not track up to
+// date for a build of the current target.
+const prepareBuild = () => {
+  touchOverriddenFiles()
+  touchOverriddenVectorIconFiles()
+  util.updateBranding()
+}
+
 /**
  * Checks to make sure the src/chrome/VERSION matches brave-browser's package.json version
  */
@@ -85,34 +101,138 @@ const checkVersionsMatch = () => {
   }
 }
 
+const signBuild = () => {
+  if (config.shouldSign()) {
+    util.signApp()
+  }
+
+  if (process.platform === 'win32') {
+    // Sign only binaries for widevine sig generation.
+    // Other binaries will be done during the create_dist.
+    // Then, both are merged whenarchive for installer is created.
+    util.signWinBinaries()
+
+    if (config.brave_enable_cdm_host_verification) {
+      util.generateWidevineSigFiles()
+    }
+  }
+}
+
+/**
+ * Parses --targets, e.g. `linux:x64,linux:x86,android:arm64`
+ */
+const parseTargets = (targets) => {
+  return targets.split(',').filter((target) => target.trim()).map((target) => {
+    const [targetOS, targetArch = 'x64'] = target.trim().split(':')
+    return { name: `${targetOS}:${targetArch}`, os: targetOS, arch: targetArch }
+  })
+}
+
+const formatDuration = (ms) => {
+  const seconds = Math.round(ms / 1000)
+  return `${Math.floor(seconds / 60)}m${('0' + (seconds % 60)).slice(-2)}s`
+}
+
+const runExecutor = (executor, target, ninjaOpts, env) => {
+  return new Promise((resolve) => {
+    const prog = spawn(executor.binary, executor.translateArgs(ninjaOpts), {
+      env,
+      cwd: config.srcDir,
+      shell: process.platform === 'win32'
+    })
+    // Prefix every line so the interleaved output of concurrent builds stays readable.
+    for (const stream of [prog.stdout, prog.stderr]) {
+      readline.createInterface({ input: stream }).on('line', (line) => {
+        console.log(`[${target.name}] ${line}`)
+      })
+    }
+    prog.on('close', (statusCode) => {
+      executor.normalizeLog(target.outputDir)
+      resolve(statusCode)
+    })
+  })
+}
+
+// Builds several target_os/target_arch pairs from the same checkout. gn gen
+// and the source tree preparation run serially since they touch shared files,
+// then all executor processes run concurrently sharing one job budget.
+const buildTargets = async (targets, options) => {
+  for (const target of targets) {
+    config.selectTarget(target.os, target.arch, options)
+    console.log(`preparing ${target.name} in ${config.outputDir}...`)
+    touchOverriddenFiles()
+    util.updateBranding()
+    util.generateNinjaFiles()
+    target.outputDir = config.outputDir
+    target.ninjaOpts = util.getNinjaOpts()
+    target.env = config.defaultOptions.env
+  }
+
+  const jobs = parseInt(options.jobs, 10) || os.cpus().length + 2
+  const executor = buildExecutors.getExecutor(config.buildExecutor)
+  const jobServer = new JobServer(jobs, targets.length, targets[0].env, executor.name === 'ninja')
+  jobServer.start()
+  console.log(jobServer.supported
+    ? `building ${targets.length} targets sharing a jobserver with ${jobs} jobs`
+    : `building ${targets.length} targets with ${jobs} jobs split between them`)
+
+  const startTime = Date.now()
+  try {
+    await Promise.all(targets.map(async (target, index) => {
+      const client = jobServer.clientOptions(index, target.env)
+      target.status = await runExecutor(executor, target, [...target.ninjaOpts, ...client.ninjaOpts], client.env)
+      target.duration = Date.now() - startTime
+      console.log(`[${target.name}] ${target.status === 0 ? 'finished' : 'FAILED'} after ${formatDuration(target.duration)}`)
+    }))
+  } finally {
+    jobServer.stop()
+  }
+
+  console.log('build summary:')
+  for (const target of targets) {
+    console.log(`  ${target.name.padEnd(16)} ${(target.status === 0 ? 'ok' : 'failed').padEnd(8)} ${formatDuration(target.duration)}  ${target.outputDir}`)
+  }
+  const failed = targets.filter((target) => target.status !== 0)
+  if (failed.length) {
+    process.exit(1)
+  }
+
+  for (const target of targets) {
+    config.selectTarget(target.os, target.arch, options)
+    signBuild()
+  }
+}
+
 const build = (buildConfig = config.defaultBuildConfig, options) => {
   config.buildConfig = buildConfig
   config.update(options)
   checkVersionsMatch()
 
-  touchOverriddenFiles()
-  touchOverriddenVectorIconFiles()
-  util.updateBranding()
+  if (options.targets) {
+    assert(!options.C && !options.xcode_gen, '--targets cannot be combined with -C or --xcode_gen')
+    touchOverriddenVectorIconFiles()
+    return buildTargets(parseTargets(options.targets), options)
+  }
+
+  prepareBuild()
 
   if (config.xcode_gen_target) {
     util.generateXcodeWorkspace()
   } else {
     util.buildTarget()
-    if (config.shouldSign()) {
-      util.signApp()
-    }
-
-    if (process.platform === 'win32') {
-      // Sign only binaries for widevine sig generation.
-      // Other binaries will be done during the create_dist.
-      // Then, both are merged whenarchive for installer is created.
-      util.signWinBinaries()
-
-      if (config.brave_enable_cdm_host_verification) {
-        util.generateWidevineSigFiles()
+    // BOLT optimizes the linked brave into brave.bolt, before signing.
+    const postLink = options.bolt ? bolt(options) : Promise.resolve()
+    return postLink.then(() => {
+      signBuild()
+      if (options.compare_executors) {
+        compareExecutors(options.compare_executors, options)
       }
-    }
+    }, (e) => {
+      console.error(e.message)
+      process.exit(1)
+    })
   }
 }
 
 module.exports = build
+module.exports.prepareBuild = prepareBuild
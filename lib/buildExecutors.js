@@ -0,0 +1,123 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const fs = require('fs-extra')
+
+// ninja flags which take a value, so translation keeps pairs together.
+const flagsWithValue = ['-C', '-f', '-j', '-k', '-l', '-d', '-t', '-w']
+
+const ninjaLogHeader = '# ninja log v5\n'
+
+// n2 keeps its state in .n2_db rather than .ninja_log. `-d trace` makes it
+// write a Chrome trace of the build which is converted into .ninja_log
+// entries so ninjatracing, post_build_ninja_summary.py etc. keep working.
+// The entries are synthetic: only trace events named after an output which
+// exists are kept, and n2 does not expose command hashes or mtimes, so both
+// are 0. ninja therefore rebuilds those outputs once if it builds the dir
+// again.
+const n2TraceToNinjaLog = (outputDir) => {
+  const tracePath = path.join(outputDir, 'trace.json')
+  if (!fs.existsSync(tracePath)) {
+    return
+  }
+  let trace
+  try {
+    trace = JSON.parse(fs.readFileSync(tracePath, 'utf8'))
+  } catch (e) {
+    console.warn(`Could not parse n2 trace at ${tracePath}: ${e.message}`)
+    return
+  }
+  const events = (Array.isArray(trace) ? trace : trace.traceEvents || [])
+    .filter((event) => event.ph === 'X' && event.name)
+  fs.removeSync(tracePath)
+  if (!events.length) {
+    return
+  }
+  const traceStart = Math.min(...events.map((event) => event.ts))
+  const lines = events.filter((event) => fs.existsSync(path.join(outputDir, event.name))).map((event) => {
+    const start = Math.round((event.ts - traceStart) / 1000)
+    const end = Math.round((event.ts + (event.dur || 0) - traceStart) / 1000)
+    return [start, end, 0, event.name, '0'].join('\t')
+  })
+  if (!lines.length) {
+    return
+  }
+  // Like ninja, append to the log of earlier builds, whose times are
+  // relative to the start of their own build.
+  const logPath = path.join(outputDir, '.ninja_log')
+  if (!fs.existsSync(logPath) || !fs.readFileSync(logPath, 'utf8').startsWith(ninjaLogHeader)) {
+    fs.writeFileSync(logPath, ninjaLogHeader)
+  }
+  fs.appendFileSync(logPath, lines.join('\n') + '\n')
+}
+
+// All executors below share ninja's `-k N` semantics where 0 means keep going
+// regardless of failures, so util.getNinjaOpts() output passes through as is.
+const executors = {
+  ninja: {
+    binary: 'ninja'
+  },
+  samu: {
+    binary: 'samu',
+    supportedFlags: ['-C', '-f', '-j', '-k', '-l', '-n', '-v', '-d', '-t', '-w']
+  },
+  n2: {
+    binary: 'n2',
+    supportedFlags: ['-C', '-j', '-k', '-v', '-d', '-t'],
+    extraArgs: ['-d', 'trace'],
+    normalizeLog: n2TraceToNinjaLog
+  },
+  siso: {
+    binary: 'siso',
+    prefixArgs: ['ninja'],
+    supportedFlags: ['-C', '-f', '-j', '-k', '-n', '-v', '-d', '-t']
+  }
+}
+
+const aliases = {
+  samurai: 'samu'
+}
+
+// Translates ninja command-line options (including config.extraNinjaOpts)
+// for |executor|, dropping the ones it does not understand.
+const translateArgs = (executor, ninjaOpts) => {
+  const args = [...(executor.prefixArgs || [])]
+  for (let i = 0; i < ninjaOpts.length; i++) {
+    const arg = String(ninjaOpts[i])
+    const takesValue = flagsWithValue.includes(arg)
+    if (arg.startsWith('-') && executor.supportedFlags && !executor.supportedFlags.includes(arg)) {
+      console.warn(`${executor.name} does not support ${arg}, ignoring it`)
+      if (takesValue) {
+        i++
+      }
+      continue
+    }
+    args.push(arg)
+    if (takesValue && i + 1 < ninjaOpts.length) {
+      args.push(String(ninjaOpts[++i]))
+    }
+  }
+  return args.concat(executor.extraArgs || [])
+}
+
+const getExecutor = (name = 'ninja') => {
+  const executorName = aliases[name] || name
+  if (!executors[executorName]) {
+    throw new Error(`Unknown build executor "${name}". Available executors: ${Object.keys(executors).join(', ')}`)
+  }
+  const executor = Object.assign({
+    name: executorName,
+    normalizeLog: () => {}
+  }, executors[executorName])
+  executor.translateArgs = (ninjaOpts) => translateArgs(executor, ninjaOpts)
+  return executor
+}
+
+module.exports = {
+  getExecutor,
+  translateArgs: (name, ninjaOpts) => getExecutor(name).translateArgs(ninjaOpts),
+  n2TraceToNinjaLog
+}
@@ -0,0 +1,50 @@
+const path = require('path')
+const fs = require('fs-extra')
+const os = require('os')
+const buildExecutors = require('./buildExecutors')
+
+test('passes ninja options through unchanged for ninja', function () {
+  const args = buildExecutors.translateArgs('ninja', ['-C', 'out/Debug', 'brave', '-k', 1, '-l', '8'])
+  expect(args).toEqual(['-C', 'out/Debug', 'brave', '-k', '1', '-l', '8'])
+})
+
+test('drops options the executor does not support', function () {
+  const args = buildExecutors.translateArgs('n2', ['-C', 'out/Debug', 'brave', '-k', 0, '-l', '8'])
+  expect(args).toEqual(['-C', 'out/Debug', 'brave', '-k', '0', '-d', 'trace'])
+})
+
+test('prefixes siso arguments with its ninja subcommand', function () {
+  expect(buildExecutors.translateArgs('siso', ['-C', 'out/Debug', 'brave'])).toEqual(['ninja', '-C', 'out/Debug', 'brave'])
+})
+
+test('resolves aliases and rejects unknown executors', function () {
+  expect(buildExecutors.getExecutor('samurai').binary).toBe('samu')
+  expect(() => buildExecutors.getExecutor('make')).toThrow()
+})
+
+test('converts an n2 trace into a ninja log', async function () {
+  const outputDir = await fs.mkdtemp(path.join(os.tmpdir(), 'brave-browser-test-build-executors-'))
+  try {
+    await fs.ensureDir(path.join(outputDir, 'obj'))
+    await fs.writeFile(path.join(outputDir, 'obj', 'a.o'), '')
+    await fs.writeFile(path.join(outputDir, 'brave'), '')
+    await fs.writeFile(path.join(outputDir, '.ninja_log'), '# ninja log v5\n0\t5\t0\tobj/b.o\t1f2e3d\n')
+    await fs.writeFile(path.join(outputDir, 'trace.json'), JSON.stringify([
+      { name: 'obj/a.o', ph: 'X', ts: 1000, dur: 2000 },
+      { name: 'brave', ph: 'X', ts: 4000, dur: 5000 },
+      { name: 'ACTION //brave:version', ph: 'X', ts: 5000, dur: 100 }
+    ]))
+    buildExecutors.n2TraceToNinjaLog(outputDir)
+    const log = (await fs.readFile(path.join(outputDir, '.ninja_log'), 'utf8')).split('\n')
+    expect(log).toEqual([
+      '# ninja log v5',
+      '0\t5\t0\tobj/b.o\t1f2e3d',
+      '0\t2\t0\tobj/a.o\t0',
+      '3\t8\t0\tbrave\t0',
+      ''
+    ])
+    expect(fs.existsSync(path.join(outputDir, 'trace.json'))).toBe(false)
+  } finally {
+    await fs.remove(outputDir)
+  }
+})
@@ -0,0 +1,267 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const crypto = require('crypto')
+const fs = require('fs-extra')
+const config = require('../lib/config')
+const util = require('../lib/util')
+
+// Increment schema version if we make breaking changes
+// to the index file format.
+const indexSchemaVersion = 1
+const indexDirName = 'brave_build_graph'
+const chromiumSrcPrefix = '//brave/chromium_src/'
+// Fields of `gn desc` which list files a target consumes.
+const fileFields = ['sources', 'public', 'inputs']
+
+const sourceShard = (file) => crypto.createHash('md5').update(file).digest('hex').substring(0, 2)
+
+// Label of the directory a target is declared in, e.g. //brave/browser for
+// //brave/browser:browser(//build/toolchain/linux:clang_x64).
+const labelDir = (label) => label.split(/[:(]/)[0]
+
+// Converts a path from the out dir (as used by runtime_deps) into a
+// source-absolute path when it points into the checkout.
+const outputPathToSourcePath = (outputDir, file) => {
+  const relative = path.relative(config.srcDir, path.resolve(outputDir, file)).replace(/\\/g, '/')
+  if (relative.startsWith('..')) {
+    return file
+  }
+  return '//' + relative + (file.endsWith('/') ? '/' : '')
+}
+
+// Parses build.ninja.d, which lists every gn file loaded by `gn gen`.
+const parseGnInputs = (depfileContents) => {
+  const separator = depfileContents.indexOf(': ')
+  if (separator < 0) {
+    return []
+  }
+  return depfileContents.substring(separator + 2).split(/\s+/).filter((file) => file)
+}
+
+// A queryable index of the gn graph of an out dir, kept in
+// <out>/brave_build_graph. The forward graph is stored whole for incremental
+// updates while file lookups are sharded, so queries only read what they need.
+module.exports = class BuildGraph {
+  constructor (outputDir = config.outputDir) {
+    this.outputDir = outputDir
+    this.indexDir = path.join(outputDir, indexDirName)
+    this.cache = {}
+  }
+
+  indexPath (name) {
+    return path.join(this.indexDir, name + '.json')
+  }
+
+  read (name) {
+    if (!this.cache[name]) {
+      const file = this.indexPath(name)
+      this.cache[name] = fs.existsSync(file) ? fs.readJsonSync(file) : null
+    }
+    return this.cache[name]
+  }
+
+  gnInputs () {
+    const depfile = path.join(this.outputDir, 'build.ninja.d')
+    const inputs = {}
+    for (const file of parseGnInputs(fs.readFileSync(depfile, 'utf8'))) {
+      const fullPath = path.resolve(this.outputDir, file)
+      inputs[file] = fs.existsSync(fullPath) ? fs.statSync(fullPath).mtimeMs : 0
+    }
+    return inputs
+  }
+
+  // Returns null when the index is up to date, 'full' when it has to be
+  // rebuilt or the list of BUILD.gn files to describe again.
+  staleness (gnInputs) {
+    const meta = this.read('meta')
+    if (!meta || meta.schemaVersion !== indexSchemaVersion) {
+      return 'full'
+    }
+    const files = new Set([...Object.keys(meta.gnInputs), ...Object.keys(gnInputs)])
+    const changed = [...files].filter((file) => meta.gnInputs[file] !== gnInputs[file])
+    if (!changed.length) {
+      return null
+    }
+    // .gni, .gn and args.gn changes can affect any target.
+    if (changed.some((file) => path.basename(file) !== 'BUILD.gn' ||
+        !(file in meta.gnInputs) || !(file in gnInputs))) {
+      return 'full'
+    }
+    return changed
+  }
+
+  describe (pattern, field) {
+    const options = Object.assign({}, config.defaultOptions, {
+      stdio: 'pipe',
+      maxBuffer: 1024 * 1024 * 1024,
+      continueOnFail: true
+    })
+    const prog = util.run('gn', ['desc', this.outputDir, `"${pattern}"`, field, '--format=json'], options)
+    if (prog.status !== 0) {
+      // e.g. a BUILD.gn which no longer declares any target.
+      console.warn(`gn desc ${pattern} ${field} failed: ${prog.stdout.toString().trim()}`)
+      return {}
+    }
+    return JSON.parse(prog.stdout.toString())
+  }
+
+  describeTargets (pattern) {
+    const targets = {}
+    const deps = this.describe(pattern, 'deps')
+    for (const label in deps) {
+      targets[label] = { deps: deps[label].deps || [], files: [] }
+    }
+    for (const field of fileFields) {
+      const described = this.describe(pattern, field)
+      for (const label in described) {
+        if (targets[label] && described[label][field]) {
+          targets[label].files.push(...described[label][field])
+        }
+      }
+    }
+    return targets
+  }
+
+  describeTests () {
+    const options = Object.assign({}, config.defaultOptions, { stdio: 'pipe' })
+    const prog = util.run('gn', ['ls', this.outputDir, '"//*"', '--type=executable', '--testonly=true', '--as=label'], options)
+    const tests = {}
+    for (const label of prog.stdout.toString().split(/\r?\n/).filter((line) => line)) {
+      tests[label] = []
+      // runtime_deps are only gathered for our own suites, the Chromium ones
+      // are too many to describe after every gn gen.
+      if (label.startsWith('//brave/')) {
+        const runtimeDeps = util.run('gn', ['desc', this.outputDir, label, 'runtime_deps'], options)
+        tests[label] = runtimeDeps.stdout.toString().split(/\r?\n/).filter((line) => line)
+          .map((file) => outputPathToSourcePath(this.outputDir, file))
+      }
+    }
+    return tests
+  }
+
+  // Brings the index up to date after `gn gen`. BUILD.gn-only changes
+  // re-describe just the affected directories.
+  update (force = false) {
+    const gnInputs = this.gnInputs()
+    const staleness = force ? 'full' : this.staleness(gnInputs)
+    if (!staleness) {
+      return false
+    }
+    let targets
+    if (staleness === 'full') {
+      console.log('indexing build graph of ' + this.outputDir + '...')
+      targets = this.describeTargets('//*')
+    } else {
+      targets = this.read('targets')
+      for (const buildFile of staleness) {
+        const dir = outputPathToSourcePath(this.outputDir, path.dirname(buildFile))
+        console.log('reindexing ' + dir + '...')
+        for (const label of Object.keys(targets)) {
+          if (labelDir(label) === dir) {
+            delete targets[label]
+          }
+        }
+        Object.assign(targets, this.describeTargets(dir + ':*'))
+      }
+    }
+    this.write(targets, this.describeTests(), gnInputs)
+    return true
+  }
+
+  write (targets, tests, gnInputs) {
+    const rdeps = {}
+    const shards = {}
+    for (const label in targets) {
+      for (const dep of targets[label].deps) {
+        (rdeps[dep] = rdeps[dep] || []).push(label)
+      }
+      for (const file of targets[label].files) {
+        const shard = shards[sourceShard(file)] = shards[sourceShard(file)] || {}
+        ;(shard[file] = shard[file] || []).push(label)
+      }
+    }
+    fs.removeSync(this.indexDir)
+    fs.ensureDirSync(path.join(this.indexDir, 'files'))
+    for (const shard in shards) {
+      fs.writeJsonSync(this.indexPath(path.join('files', shard)), shards[shard])
+    }
+    fs.writeJsonSync(this.indexPath('targets'), targets)
+    fs.writeJsonSync(this.indexPath('rdeps'), rdeps)
+    fs.writeJsonSync(this.indexPath('meta'), {
+      schemaVersion: indexSchemaVersion,
+      gnInputs,
+      tests
+    })
+    this.cache = {}
+  }
+
+  // Accepts source-absolute (//brave/...), src-relative or absolute paths.
+  static normalizeFile (file) {
+    if (file.startsWith('//')) {
+      return file
+    }
+    const fullPath = path.isAbsolute(file) ? file : path.resolve(process.cwd(), file)
+    let relative = path.relative(config.srcDir, fullPath)
+    if (relative.startsWith('..')) {
+      relative = file
+    }
+    return '//' + relative.replace(/\\/g, '/')
+  }
+
+  // chromium_src overrides are not listed in any target. They are compiled
+  // (or included) in place of the Chromium file they override.
+  static overriddenFile (file) {
+    return file.startsWith(chromiumSrcPrefix)
+      ? '//' + file.substring(chromiumSrcPrefix.length)
+      : null
+  }
+
+  targetsForFile (file) {
+    file = BuildGraph.normalizeFile(file)
+    const labels = new Set()
+    for (const candidate of [file, BuildGraph.overriddenFile(file)]) {
+      const shard = candidate && this.read(path.join('files', sourceShard(candidate)))
+      if (shard && shard[candidate]) {
+        shard[candidate].forEach((label) => labels.add(label))
+      }
+    }
+    // Data files reach tests through runtime_deps, which may list directories.
+    const tests = this.read('meta').tests
+    for (const test in tests) {
+      if (tests[test].some((dep) => dep === file || (dep.endsWith('/') && file.startsWith(dep)))) {
+        labels.add(test)
+      }
+    }
+    return [...labels]
+  }
+
+  // Transitive closure over reverse (or, with |forward|, regular) deps.
+  closure (labels, forward = false) {
+    const edges = forward
+      ? (label) => (this.read('targets')[label] || { deps: [] }).deps
+      : (label) => this.read('rdeps')[label] || []
+    const seen = new Set(labels)
+    const queue = [...labels]
+    while (queue.length) {
+      for (const next of edges(queue.pop())) {
+        if (!seen.has(next)) {
+          seen.add(next)
+          queue.push(next)
+        }
+      }
+    }
+    return seen
+  }
+
+  testsFor (labels) {
+    const tests = this.read('meta').tests
+    return [...this.closure(labels)].filter((label) => label in tests)
+  }
+}
+
+module.exports.parseGnInputs = parseGnInputs
+module.exports.labelDir = labelDir
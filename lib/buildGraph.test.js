@@ -0,0 +1,82 @@
+const path = require('path')
+const fs = require('fs-extra')
+const os = require('os')
+const BuildGraph = require('./buildGraph')
+
+const dirPrefixTmp = 'brave-browser-test-build-graph-'
+let outputDir, buildGraph
+
+const targets = {
+  '//brave/browser:browser': {
+    deps: ['//chrome/browser:browser'],
+    files: ['//brave/browser/brave_tab_helpers.cc']
+  },
+  '//chrome/browser:browser': {
+    deps: [],
+    files: ['//chrome/browser/profiles/profile_manager.cc']
+  },
+  '//brave/test:brave_unit_tests': {
+    deps: ['//brave/browser:browser'],
+    files: ['//brave/browser/brave_tab_helpers_unittest.cc']
+  },
+  '//brave/test:brave_browser_tests': {
+    deps: ['//chrome/browser:browser'],
+    files: []
+  }
+}
+const tests = {
+  '//brave/test:brave_unit_tests': ['//brave/test/data/'],
+  '//brave/test:brave_browser_tests': []
+}
+const gnInputs = {
+  '../../brave/browser/BUILD.gn': 1,
+  '../../brave/build/config.gni': 1
+}
+
+beforeEach(async function () {
+  outputDir = await fs.mkdtemp(path.join(os.tmpdir(), dirPrefixTmp))
+  buildGraph = new BuildGraph(outputDir)
+  buildGraph.write(JSON.parse(JSON.stringify(targets)), tests, gnInputs)
+})
+
+afterEach(async function () {
+  await fs.remove(outputDir)
+})
+
+test('finds the targets of a file', function () {
+  expect(buildGraph.targetsForFile('//brave/browser/brave_tab_helpers.cc')).toEqual(['//brave/browser:browser'])
+  expect(buildGraph.targetsForFile('//brave/browser/unknown.cc')).toEqual([])
+})
+
+test('maps chromium_src overrides to the file they replace', function () {
+  expect(buildGraph.targetsForFile('//brave/chromium_src/chrome/browser/profiles/profile_manager.cc'))
+    .toEqual(['//chrome/browser:browser'])
+})
+
+test('maps data files to tests through runtime_deps', function () {
+  expect(buildGraph.targetsForFile('//brave/test/data/adblock/rules.txt')).toEqual(['//brave/test:brave_unit_tests'])
+})
+
+test('finds the tests depending on a target', function () {
+  expect(buildGraph.testsFor(['//brave/browser:browser'])).toEqual(['//brave/test:brave_unit_tests'])
+  expect(buildGraph.testsFor(['//chrome/browser:browser']).sort())
+    .toEqual(['//brave/test:brave_browser_tests', '//brave/test:brave_unit_tests'])
+})
+
+test('walks forward deps', function () {
+  expect([...buildGraph.closure(['//brave/test:brave_unit_tests'], true)].sort())
+    .toEqual(['//brave/browser:browser', '//brave/test:brave_unit_tests', '//chrome/browser:browser'])
+})
+
+test('only reindexes changed BUILD.gn files', function () {
+  expect(buildGraph.staleness(gnInputs)).toBeNull()
+  expect(buildGraph.staleness(Object.assign({}, gnInputs, { '../../brave/browser/BUILD.gn': 2 })))
+    .toEqual(['../../brave/browser/BUILD.gn'])
+  expect(buildGraph.staleness(Object.assign({}, gnInputs, { '../../brave/build/config.gni': 2 }))).toBe('full')
+})
+
+test('parses the gn depfile', function () {
+  expect(BuildGraph.parseGnInputs('build.ninja: ../../BUILD.gn ../../brave/BUILD.gn\n'))
+    .toEqual(['../../BUILD.gn', '../../brave/BUILD.gn'])
+  expect(BuildGraph.labelDir('//brave/browser:browser(//build/toolchain/linux:clang_x64)')).toBe('//brave/browser')
+})
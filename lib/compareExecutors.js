@@ -0,0 +1,65 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const fs = require('fs-extra')
+const config = require('../lib/config')
+const util = require('../lib/util')
+const buildExecutors = require('./buildExecutors')
+
+const defaultTouchFile = path.join('brave', 'browser', 'brave_browser_main_parts.cc')
+
+const median = (values) => {
+  const sorted = [...values].sort((a, b) => a - b)
+  return sorted[Math.floor(sorted.length / 2)]
+}
+
+const timeBuild = (executor, ninjaOpts) => {
+  const startTime = process.hrtime()
+  util.run(executor.binary, executor.translateArgs(ninjaOpts), config.defaultOptions)
+  executor.normalizeLog(config.outputDir)
+  const [seconds, nanoseconds] = process.hrtime(startTime)
+  return seconds * 1000 + nanoseconds / 1e6
+}
+
+// Runs null builds and an incremental build after touching |touchFile| with
+// each executor against the current out dir. Every executor keeps its own
+// state (.ninja_log/.ninja_deps, .n2_db, ...), so each one first gets a
+// warm-up build which is not measured.
+const compareExecutors = (executorNames, options = {}) => {
+  const executors = executorNames.split(',').map((name) => buildExecutors.getExecutor(name.trim()))
+  const runs = parseInt(options.compare_runs, 10) || 3
+  const touchPath = path.join(config.srcDir, options.touch || defaultTouchFile)
+  const ninjaOpts = util.getNinjaOpts()
+
+  const results = executors.map((executor) => {
+    console.log(`comparing ${executor.name}: warm-up build...`)
+    timeBuild(executor, ninjaOpts)
+
+    const nullBuilds = []
+    for (let i = 0; i < runs; i++) {
+      nullBuilds.push(timeBuild(executor, ninjaOpts))
+    }
+
+    const now = new Date()
+    fs.utimesSync(touchPath, now, now)
+    const incremental = timeBuild(executor, ninjaOpts)
+
+    return {
+      executor: executor.name,
+      nullBuildMs: Math.round(median(nullBuilds)),
+      incrementalBuildMs: Math.round(incremental)
+    }
+  })
+
+  console.log(`executor comparison for ${config.buildTarget} (null build median of ${runs}, incremental after touching ${path.relative(config.srcDir, touchPath)}):`)
+  for (const result of results) {
+    console.log(`  ${result.executor.padEnd(8)} null ${(result.nullBuildMs / 1000).toFixed(2).padStart(8)}s  incremental ${(result.incrementalBuildMs / 1000).toFixed(2).padStart(8)}s`)
+  }
+  fs.writeJsonSync(path.join(config.outputDir, 'executor_comparison.json'), results, { spaces: 2 })
+  return results
+}
+
+module.exports = compareExecutors
@@ -0,0 +1,151 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const fs = require('fs-extra')
+const { measureStartup, withBenchmarkEnvironment } = require('./startupBenchmark')
+const { sampleMemory } = require('./processMemory')
+const { summarize } = require('./benchmarkStats')
+const { sleep } = require('./browserProcess')
+
+// Brave components which `start` options turn on or off, with the option
+// value that turns each one off.
+const components = {
+  brave_extension: { option: 'disable_brave_extension', off: true },
+  brave_rewards_extension: { option: 'disable_brave_rewards_extension', off: true },
+  pdfjs_extension: { option: 'disable_pdfjs_extension', off: true },
+  webtorrent_extension: { option: 'disable_webtorrent_extension', off: true },
+  smart_tracking_protection: { option: 'enable_smart_tracking_protection', off: false }
+}
+
+const memorySamples = 3
+
+// `start` options which turn on exactly |enabled| of the components.
+const toggleOptions = (enabled) => {
+  const options = {}
+  for (const [name, component] of Object.entries(components)) {
+    options[component.option] = enabled.includes(name) ? !component.off : component.off
+  }
+  return options
+}
+
+// Sets of enabled components to measure. The baseline has every component
+// off; 'one_at_a_time' adds each component alone to it and 'full' measures
+// every combination.
+const componentSets = (matrix) => {
+  const names = Object.keys(components)
+  if (matrix === 'full') {
+    const sets = []
+    for (let mask = 0; mask < (1 << names.length); mask++) {
+      sets.push(names.filter((name, index) => mask & (1 << index)))
+    }
+    return sets
+  }
+  if (matrix !== 'one_at_a_time') {
+    throw new Error(`Unknown component matrix "${matrix}", use one_at_a_time or full`)
+  }
+  return [[]].concat(names.map((name) => [name]), [names])
+}
+
+const setName = (enabled) => enabled.length ? enabled.join('+') : 'baseline'
+
+// Memory by process type, averaged over a few samples taken a second apart.
+const steadyStateMemory = async (pid) => {
+  const totals = {}
+  for (let i = 0; i < memorySamples; i++) {
+    for (const [type, memory] of Object.entries(sampleMemory(pid))) {
+      const total = totals[type] || (totals[type] = { count: 0, rss: 0, private: 0 })
+      total.count += memory.count / memorySamples
+      total.rss += memory.rss / memorySamples
+      total.private += memory.private / memorySamples
+    }
+    await sleep(1000)
+  }
+  return totals
+}
+
+// Runs the browser |runs| times for every component set of
+// |options.matrix|, measuring first paint and, after |options.settleSeconds|,
+// the RSS and private memory of every process type. Writes the measurements
+// and the cost of each component relative to the baseline to
+// |options.output|. Linux only, since memory is read from /proc.
+const componentBenchmark = async (binary, argsFor, runs, options) => {
+  if (process.platform !== 'linux') {
+    throw new Error('The component benchmark is only supported on Linux')
+  }
+  const sets = componentSets(options.matrix)
+  const report = { binary, runs, settleSeconds: options.settleSeconds, configs: {}, components: {} }
+
+  for (const enabled of sets) {
+    const name = setName(enabled)
+    const firstPaint = []
+    const memoryRuns = []
+    await withBenchmarkEnvironment(argsFor(toggleOptions(enabled)), async (benchArgs, env) => {
+      for (let run = 1; run <= runs; run++) {
+        const metrics = await measureStartup(binary, benchArgs, options.profile, env, async (browser) => {
+          await sleep(options.settleSeconds * 1000)
+          memoryRuns.push(await steadyStateMemory(browser.pid))
+        })
+        console.log(`${name} run ${run}/${runs}: first paint ${metrics && metrics.first_paint}ms`)
+        firstPaint.push(metrics && metrics.first_paint)
+      }
+    })
+
+    const types = new Set([].concat(...memoryRuns.map((memory) => Object.keys(memory))))
+    const memory = {}
+    for (const type of types) {
+      memory[type] = {
+        count: summarize(memoryRuns.map((run) => run[type] ? run[type].count : 0)).p50,
+        rss_mb: summarize(memoryRuns.map((run) => run[type] ? run[type].rss : 0)),
+        private_mb: summarize(memoryRuns.map((run) => run[type] ? run[type].private : 0))
+      }
+    }
+    const total = (field) => summarize(memoryRuns.map((run) =>
+      Object.values(run).reduce((sum, typeMemory) => sum + typeMemory[field], 0)))
+    report.configs[name] = {
+      enabled,
+      first_paint_ms: summarize(firstPaint),
+      total_rss_mb: total('rss'),
+      total_private_mb: total('private'),
+      memory
+    }
+  }
+
+  // Cost of a component: its configuration alone minus the baseline, by
+  // median.
+  const baseline = report.configs.baseline
+  for (const name of Object.keys(components)) {
+    const config = report.configs[name]
+    if (!config) {
+      continue
+    }
+    const delta = (field) => config[field].p50 === null || baseline[field].p50 === null
+      ? null
+      : Math.round((config[field].p50 - baseline[field].p50) * 100) / 100
+    const byType = {}
+    for (const type of new Set(Object.keys(config.memory).concat(Object.keys(baseline.memory)))) {
+      const p50 = (memory, field) => memory[type] ? memory[type][field].p50 : 0
+      byType[type] = {
+        rss_mb: Math.round((p50(config.memory, 'rss_mb') - p50(baseline.memory, 'rss_mb')) * 100) / 100,
+        private_mb: Math.round((p50(config.memory, 'private_mb') - p50(baseline.memory, 'private_mb')) * 100) / 100
+      }
+    }
+    report.components[name] = {
+      first_paint_ms: delta('first_paint_ms'),
+      rss_mb: delta('total_rss_mb'),
+      private_mb: delta('total_private_mb'),
+      by_process_type: byType
+    }
+    console.log(`${name}: first paint ${report.components[name].first_paint_ms}ms, ` +
+      `RSS ${report.components[name].rss_mb}MB, private ${report.components[name].private_mb}MB over the baseline`)
+  }
+
+  fs.writeJsonSync(options.output, report, { spaces: 2 })
+  console.log(`component benchmark written to ${options.output}`)
+  return report
+}
+
+module.exports = componentBenchmark
+module.exports.componentSets = componentSets
+module.exports.toggleOptions = toggleOptions
@@ -0,0 +1,36 @@
+const componentBenchmark = require('./componentBenchmark')
+
+test('measures the baseline, each component alone and all of them', function () {
+  const sets = componentBenchmark.componentSets('one_at_a_time')
+  expect(sets).toEqual([
+    [],
+    ['brave_extension'],
+    ['brave_rewards_extension'],
+    ['pdfjs_extension'],
+    ['webtorrent_extension'],
+    ['smart_tracking_protection'],
+    ['brave_extension', 'brave_rewards_extension', 'pdfjs_extension', 'webtorrent_extension', 'smart_tracking_protection']
+  ])
+})
+
+test('measures every combination of components in the full matrix', function () {
+  const sets = componentBenchmark.componentSets('full')
+  expect(sets.length).toBe(32)
+  expect(new Set(sets.map((set) => set.join('+'))).size).toBe(32)
+  expect(sets[0]).toEqual([])
+  expect(() => componentBenchmark.componentSets('some')).toThrow()
+})
+
+test('turns components on and off through their start options', function () {
+  expect(componentBenchmark.toggleOptions([])).toEqual({
+    disable_brave_extension: true,
+    disable_brave_rewards_extension: true,
+    disable_pdfjs_extension: true,
+    disable_webtorrent_extension: true,
+    enable_smart_tracking_protection: false
+  })
+  const options = componentBenchmark.toggleOptions(['pdfjs_extension', 'smart_tracking_protection'])
+  expect(options.disable_pdfjs_extension).toBe(false)
+  expect(options.disable_brave_extension).toBe(true)
+  expect(options.enable_smart_tracking_protection).toBe(true)
+})
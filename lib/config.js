@@ -77,6 +77,21 @@ const Config = function () {
   this.signature_generator = path.join(this.srcDir, 'third_party', 'widevine', 'scripts', 'signature_generator.py') || ''
   this.extraGnArgs = {}
   this.extraNinjaOpts = []
+  this.buildExecutor = getNPMConfig(['build_executor']) || 'ninja'
+  this.buildGraphIndex = String(getNPMConfig(['build_graph_index'])) === 'true'
+  // test_timings_dir and test_timings are the names of the history from
+  // before it also held flakiness data.
+  this.testHistoryDir = getNPMConfig(['test_history_dir']) || getNPMConfig(['test_timings_dir']) ||
+    (fs.existsSync(path.join(this.rootDir, 'test_timings')) && !fs.existsSync(path.join(this.rootDir, 'test_history'))
+      ? path.join(this.rootDir, 'test_timings')
+      : path.join(this.rootDir, 'test_history'))
+  this.testCacheDir = getNPMConfig(['test_cache_dir']) || path.join(this.rootDir, 'test_cache')
+  this.gcOutBudget = getNPMConfig(['gc_out_budget'])
+  this.pgoDir = getNPMConfig(['pgo_dir']) || path.join(this.rootDir, 'pgo_profiles')
+  this.autofdoDir = getNPMConfig(['autofdo_dir'])
+  // Sample profile (AutoFDO) clang optimizes with, if any.
+  this.sampleProfilePath = ''
+  this.boltDir = getNPMConfig(['bolt_dir'])
 }
 
 Config.prototype.buildArgs = function () {
@@ -149,6 +164,10 @@ Config.prototype.buildArgs = function () {
     args.is_win_fastlink = true
   }
 
+  if (this.sampleProfilePath) {
+    args.clang_sample_profile_path = this.sampleProfilePath
+  }
+
   if (this.sccache && process.platform === 'win32') {
     args.clang_use_chrome_plugins = false
     args.enable_precompiled_headers = false
@@ -227,6 +246,14 @@ Config.prototype.buildArgs = function () {
   return args
 }
 
+// Whether the compiler config of the Chromium checkout passes
+// clang_sample_profile_path to clang. GN ignores unknown build arguments, so
+// without this a PGO build silently gets no profile.
+Config.prototype.pgoSupported = function () {
+  const compilerConfig = path.join(this.srcDir, 'build', 'config', 'compiler', 'BUILD.gn')
+  return fs.existsSync(compilerConfig) && fs.readFileSync(compilerConfig, 'utf8').includes('-fprofile-sample-use')
+}
+
 Config.prototype.shouldSign = function () {
   // it doesn't make sense to sign debug builds because the restrictions on loading
   // dynamic libs prevents them from working anyway
@@ -319,7 +346,7 @@ Config.prototype.buildProjects = function () {
   })
 }
 
-Config.prototype.update = function (options) {
+Config.prototype.updateTarget = function (options) {
   if (options.target_arch === 'x86') {
     this.targetArch = options.target_arch
     this.gypTargetArch = 'ia32'
@@ -343,6 +370,27 @@ Config.prototype.update = function (options) {
   if (options.target_os) {
     this.targetOS = options.target_os
   }
+}
+
+// Switches to another target_os/target_arch pair, e.g. for each entry of a
+// multi-target build. The host OS maps to the default (unprefixed) out dir.
+// The Android options of |options| apply to Android targets as they do in
+// updateTarget.
+Config.prototype.selectTarget = function (targetOS, targetArch, options = {}) {
+  const hostOS = { linux: 'linux', darwin: 'mac', win32: 'win' }[process.platform]
+  this.targetOS = undefined
+  this.targetArch = 'x64'
+  this.gypTargetArch = 'x64'
+  this.updateTarget({
+    target_os: targetOS === hostOS ? undefined : targetOS,
+    target_arch: targetArch,
+    target_apk_base: options.target_apk_base,
+    android_override_version_name: options.android_override_version_name
+  })
+}
+
+Config.prototype.update = function (options) {
+  this.updateTarget(options)
 
   if (options.C) {
     this.buildConfig = path.basename(options.C)
@@ -431,6 +479,16 @@ Config.prototype.update = function (options) {
   if (options.ignore_compile_failure)
     this.ignore_compile_failure = true
 
+  if (options.disk_budget)
+    this.gcOutBudget = options.disk_budget
+
+  if (options.pgo_profile) {
+    if (!this.pgoSupported()) {
+      throw new Error('This Chromium does not build with clang_sample_profile_path, --pgo_profile would have no effect')
+    }
+    this.sampleProfilePath = path.resolve(options.pgo_profile)
+  }
+
   if (options.xcode_gen) {
     assert(process.platform === 'darwin' || options.target_os === 'ios')
     if (options.xcode_gen === 'ios') {
@@ -451,6 +509,12 @@ Config.prototype.update = function (options) {
     })
   }
 
+  if (options.executor)
+    this.buildExecutor = options.executor
+
+  if (options.graph_index)
+    this.buildGraphIndex = true
+
   if (options.ninja) {
     parseExtraInputs(options.ninja, this.extraNinjaOpts, (opts, key, value) => {
       opts.push(`-${key}`)
@@ -0,0 +1,178 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const readline = require('readline')
+const fs = require('fs-extra')
+const { spawn, spawnSync } = require('child_process')
+const BrowserProcess = require('./browserProcess')
+const flameGraph = require('./flameGraph')
+const { processTree, processType } = require('./processMemory')
+const { hasFramePointers } = require('./benchmarkProfile')
+
+const samplingFrequency = 999
+const dwarfStackBytes = 16384
+// Processes with fewer samples get no flame graph of their own.
+const minProcessSamples = 10
+
+// perf record call graph mode for a build with |buildArgs|: frame pointers
+// when the build keeps them, DWARF unwinding from copies of the stack
+// otherwise.
+const callGraphMode = (buildArgs) => hasFramePointers(buildArgs) ? 'fp' : `dwarf,${dwarfStackBytes}`
+
+const frameName = (symbol, dso) => {
+  if (!symbol || symbol === '[unknown]') {
+    return dso && dso !== '[unknown]' ? `[${path.basename(dso)}]` : '[unknown]'
+  }
+  // Semicolons separate frames in folded stacks.
+  return symbol.replace(/;/g, ':')
+}
+
+// Folds the samples printed by `perf script -F comm,pid,tid,ip,sym,dso`
+// into stacks per process, rooted at the thread name:
+//   ThreadName 1234/1240
+//           55d0c1f2a3b4 base::RunLoop::Run (/out/Release/brave)
+//           ...
+class PerfScriptFolder {
+  constructor () {
+    // pid -> Map of folded stack -> samples
+    this.processes = new Map()
+    this.sample = null
+    this.frames = []
+  }
+
+  line (text) {
+    if (!text.trim()) {
+      this.flush()
+    } else if (/^\s/.test(text)) {
+      const frame = /^\s+[0-9a-f]+\s+(.*?)\s+\((.*)\)\s*$/.exec(text)
+      if (frame) {
+        this.frames.push(frameName(frame[1], frame[2]))
+      }
+    } else {
+      this.flush()
+      const header = /^(.*?)\s+(\d+)\/\d+\s*$/.exec(text)
+      this.sample = header ? { thread: header[1].trim().replace(/;/g, ':') || '[thread]', pid: parseInt(header[2], 10) } : null
+    }
+  }
+
+  flush () {
+    if (this.sample) {
+      const stack = [this.sample.thread].concat(this.frames.reverse()).join(';')
+      if (!this.processes.has(this.sample.pid)) {
+        this.processes.set(this.sample.pid, new Map())
+      }
+      const stacks = this.processes.get(this.sample.pid)
+      stacks.set(stack, (stacks.get(stack) || 0) + 1)
+    }
+    this.sample = null
+    this.frames = []
+  }
+}
+
+const sampleCount = (stacks) => Array.from(stacks.values()).reduce((sum, count) => sum + count, 0)
+
+// Folds perf.data with `perf script`, which symbolizes against the binaries
+// the browser ran, i.e. those of the out dir.
+const foldPerfData = (perfData) => new Promise((resolve, reject) => {
+  const folder = new PerfScriptFolder()
+  const perf = spawn('perf', ['script', '-i', perfData, '--no-inline', '-F', 'comm,pid,tid,ip,sym,dso'],
+    { stdio: ['ignore', 'pipe', 'inherit'] })
+  readline.createInterface({ input: perf.stdout, crlfDelay: Infinity }).on('line', (line) => folder.line(line))
+  perf.on('error', reject)
+  perf.on('close', (code) => {
+    folder.flush()
+    if (code !== 0) {
+      reject(new Error(`perf script exited with ${code}`))
+    } else {
+      resolve(folder.processes)
+    }
+  })
+})
+
+// Runs |binary| with |args| under `perf record`, following all of its child
+// processes, until it is quit. Then writes a flame graph and the folded
+// stacks of every process which was sampled, and of all of them together,
+// to |options.outputDir|. Linux only.
+const cpuProfile = async (binary, args, options) => {
+  if (process.platform !== 'linux') {
+    throw new Error('CPU profiling is only supported on Linux')
+  }
+  const perfVersion = spawnSync('perf', ['--version'])
+  if (perfVersion.error || perfVersion.status !== 0) {
+    throw new Error('perf is not installed, it comes with the linux-tools package of your distribution')
+  }
+  const callGraph = callGraphMode(options.buildArgs)
+  if (callGraph !== 'fp') {
+    console.log('This build has no frame pointers, using DWARF unwinding. Build with --debug_build=true ' +
+      '(enable_profiling) for smaller profiles and faster symbolization.')
+  }
+  fs.emptyDirSync(options.outputDir)
+  const perfData = path.join(options.outputDir, 'perf.data')
+
+  // Process types are read from the command lines while the processes run.
+  const types = new Map()
+  const perf = new BrowserProcess('perf', ['record', `--call-graph=${callGraph}`, '-F', String(samplingFrequency),
+    '-o', perfData, '--', binary].concat(args))
+  // Ctrl+C also reaches perf, which then writes its data and exits; the
+  // profile is still processed.
+  const ignoreInterrupt = () => {}
+  process.on('SIGINT', ignoreInterrupt)
+  try {
+    console.log(`Profiling with perf (${callGraph} call graphs), quit Brave to stop...`)
+    while (!perf.exited) {
+      for (const pid of processTree(perf.pid)) {
+        if (pid !== perf.pid && !types.has(pid)) {
+          try {
+            types.set(pid, processType(fs.readFileSync(`/proc/${pid}/cmdline`, 'utf8')))
+          } catch (e) {
+            // The process exited meanwhile.
+          }
+        }
+      }
+      await BrowserProcess.sleep(BrowserProcess.pollIntervalMs)
+    }
+  } finally {
+    process.removeListener('SIGINT', ignoreInterrupt)
+  }
+  if (!fs.existsSync(perfData)) {
+    throw new Error('perf record did not write a profile')
+  }
+
+  console.log('Symbolizing the profile...')
+  const processes = await foldPerfData(perfData)
+  const all = new Map()
+  const summary = []
+  for (const [pid, stacks] of processes) {
+    const type = types.get(pid) || 'unknown'
+    const samples = sampleCount(stacks)
+    for (const [stack, count] of stacks) {
+      all.set(`${type} ${pid};${stack}`, count)
+    }
+    if (samples < minProcessSamples) {
+      continue
+    }
+    const name = `${type}-${pid}`
+    fs.writeFileSync(path.join(options.outputDir, `${name}.folded`), flameGraph.toFolded(stacks))
+    fs.writeFileSync(path.join(options.outputDir, `${name}.svg`),
+      flameGraph.toSvg(stacks, `${type} process ${pid}: ${samples} samples`))
+    summary.push({ pid, type, samples, flamegraph: path.resolve(options.outputDir, `${name}.svg`) })
+  }
+  fs.writeFileSync(path.join(options.outputDir, 'all.folded'), flameGraph.toFolded(all))
+  fs.writeFileSync(path.join(options.outputDir, 'all.svg'),
+    flameGraph.toSvg(all, `All processes: ${sampleCount(all)} samples`))
+  summary.sort((a, b) => b.samples - a.samples)
+  fs.writeJsonSync(path.join(options.outputDir, 'profile.json'),
+    { callGraph, frequency: samplingFrequency, processes: summary }, { spaces: 2 })
+
+  for (const entry of summary) {
+    console.log(`${entry.type} ${entry.pid}: ${entry.samples} samples, ${entry.flamegraph}`)
+  }
+  console.log(`CPU profile written to ${options.outputDir}, all processes in all.svg`)
+}
+
+module.exports = cpuProfile
+module.exports.PerfScriptFolder = PerfScriptFolder
+module.exports.callGraphMode = callGraphMode
@@ -0,0 +1,42 @@
+const { PerfScriptFolder, callGraphMode } = require('./cpuProfile')
+const flameGraph = require('./flameGraph')
+
+const perfScript = `CrRendererMain 1234/1234
+	    55d0c1f2a3b4 blink::Document::UpdateStyle (/out/Release/brave)
+	    55d0c1f2a000 base::RunLoop::Run (/out/Release/brave)
+	    7f00aa001000 __libc_start_main (/lib/x86_64-linux-gnu/libc-2.27.so)
+
+CrRendererMain 1234/1234
+	    55d0c1f2a3b4 blink::Document::UpdateStyle (/out/Release/brave)
+	    55d0c1f2a000 base::RunLoop::Run (/out/Release/brave)
+	    7f00aa001000 __libc_start_main (/lib/x86_64-linux-gnu/libc-2.27.so)
+
+Chrome_IOThread 1000/1002
+	    7f00aa002000 [unknown] (/lib/x86_64-linux-gnu/libpthread-2.27.so)
+`
+
+test('folds perf script samples by process', function () {
+  const folder = new PerfScriptFolder()
+  perfScript.split('\n').forEach((line) => folder.line(line))
+  folder.flush()
+  expect(Array.from(folder.processes.get(1234))).toEqual([
+    ['CrRendererMain;__libc_start_main;base::RunLoop::Run;blink::Document::UpdateStyle', 2]
+  ])
+  expect(Array.from(folder.processes.get(1000))).toEqual([
+    ['Chrome_IOThread;[libpthread-2.27.so]', 1]
+  ])
+})
+
+test('renders folded stacks as a flame graph', function () {
+  const stacks = new Map([['main;a;b', 3], ['main;a;<c>', 1]])
+  expect(flameGraph.toFolded(stacks)).toBe('main;a;<c> 1\nmain;a;b 3\n')
+  const svg = flameGraph.toSvg(stacks, 'renderer')
+  expect(svg).toContain('<title>main (4 samples, 100.00%)</title>')
+  expect(svg).toContain('<title>b (3 samples, 75.00%)</title>')
+  expect(svg).toContain('&lt;c&gt;')
+})
+
+test('unwinds with frame pointers when the build has them', function () {
+  expect(callGraphMode({ is_debug: true, enable_profiling: true })).toBe('fp')
+  expect(callGraphMode({ is_debug: false })).toBe('dwarf,16384')
+})
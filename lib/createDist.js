@@ -2,15 +2,28 @@ const config = require('../lib/config')
 const util = require('../lib/util')
 const path = require('path')
 const fs = require('fs-extra')
+const bolt = require('./bolt')
 
 const createDist = (buildConfig = config.defaultBuildConfig, options) => {
   config.buildConfig = buildConfig
   config.update(options)
 
   util.updateBranding()
-  fs.removeSync(path.join(config.outputDir, 'dist'))
-  config.buildTarget = 'create_dist'
-  util.buildTarget()
+  // With --bolt create_dist packages the brave.bolt of `build --bolt`,
+  // which has to be the optimized brave as it is linked now.
+  const prepare = options.bolt ? bolt.ensureOptimized() : Promise.resolve()
+  return prepare.then(() => {
+    fs.removeSync(path.join(config.outputDir, 'dist'))
+    config.buildTarget = 'create_dist'
+    if (options.bolt) {
+      bolt.withOptimizedBinary(() => util.buildTarget())
+    } else {
+      util.buildTarget()
+    }
+  }, (e) => {
+    console.error(e.message)
+    process.exit(1)
+  })
 }
 
 module.exports = createDist
@@ -0,0 +1,111 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const EventEmitter = require('events')
+
+// Standard streams of a browser started with --remote-debugging-pipe: it
+// reads DevTools protocol commands from fd 3 and writes to fd 4.
+const pipeStdio = ['ignore', 'ignore', 'ignore', 'pipe', 'pipe']
+
+const defaultTimeoutMs = 30000
+
+// DevTools protocol client over the pipe of a browser started with
+// --remote-debugging-pipe, where every message is JSON followed by a NUL
+// byte. Unlike the websocket endpoint this needs no extra module and no
+// free port. Events are emitted by method name with (params, sessionId).
+class DevToolsPipe extends EventEmitter {
+  constructor (browserProcess) {
+    super()
+    this.input = browserProcess.prog.stdio[3]
+    this.output = browserProcess.prog.stdio[4]
+    this.nextId = 1
+    this.pending = new Map()
+    this.pieces = []
+    this.output.on('data', (chunk) => this.read(chunk))
+    this.output.on('close', () => this.rejectAll(new Error('The DevTools pipe was closed')))
+    this.input.on('error', (e) => this.rejectAll(e))
+  }
+
+  read (chunk) {
+    let start = 0
+    let end
+    while ((end = chunk.indexOf(0, start)) !== -1) {
+      this.pieces.push(chunk.slice(start, end))
+      const message = JSON.parse(Buffer.concat(this.pieces).toString('utf8'))
+      this.pieces = []
+      start = end + 1
+      this.dispatch(message)
+    }
+    if (start < chunk.length) {
+      this.pieces.push(chunk.slice(start))
+    }
+  }
+
+  dispatch (message) {
+    if (message.id === undefined) {
+      this.emit(message.method, message.params, message.sessionId)
+      return
+    }
+    const pending = this.pending.get(message.id)
+    if (!pending) {
+      return
+    }
+    this.pending.delete(message.id)
+    clearTimeout(pending.timer)
+    if (message.error) {
+      pending.reject(new Error(`${pending.method}: ${message.error.message}`))
+    } else {
+      pending.resolve(message.result)
+    }
+  }
+
+  rejectAll (error) {
+    for (const pending of this.pending.values()) {
+      clearTimeout(pending.timer)
+      pending.reject(error)
+    }
+    this.pending.clear()
+  }
+
+  // Sends |method| to the browser, or to the target attached as |sessionId|.
+  // Resolves to the result.
+  send (method, params = {}, sessionId, timeoutMs = defaultTimeoutMs) {
+    const id = this.nextId++
+    const message = { id, method, params }
+    if (sessionId) {
+      message.sessionId = sessionId
+    }
+    return new Promise((resolve, reject) => {
+      const timer = setTimeout(() => {
+        this.pending.delete(id)
+        reject(new Error(`${method} timed out after ${timeoutMs / 1000}s`))
+      }, timeoutMs)
+      this.pending.set(id, { method, resolve, reject, timer })
+      this.input.write(JSON.stringify(message) + '\0')
+    })
+  }
+
+  // Resolves to the params of the next |method| event of |sessionId|, or to
+  // null after |timeoutMs|.
+  waitForEvent (method, sessionId, timeoutMs = defaultTimeoutMs) {
+    return new Promise((resolve) => {
+      const listener = (params, eventSessionId) => {
+        if (eventSessionId === sessionId) {
+          done(params)
+        }
+      }
+      const timer = setTimeout(() => done(null), timeoutMs)
+      const done = (params) => {
+        clearTimeout(timer)
+        this.removeListener(method, listener)
+        resolve(params)
+      }
+      this.on(method, listener)
+    })
+  }
+}
+
+module.exports = DevToolsPipe
+module.exports.pipeStdio = pipeStdio
@@ -0,0 +1,143 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const os = require('os')
+const fs = require('fs-extra')
+const { spawn } = require('child_process')
+
+const firstDisplay = 99
+const displayStartTimeoutMs = 10000
+const xvfbScreen = '1280x1024x24'
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms))
+
+const displaySocket = (display) => `/tmp/.X11-unix/X${display}`
+const isDisplayInUse = (display) =>
+  fs.existsSync(`/tmp/.X${display}-lock`) || fs.existsSync(displaySocket(display))
+
+// Held by a pool while it uses a display. Xvfb only writes its own lock once
+// it started, so concurrent pools claim displays through these instead.
+const claimFile = (display) => `/tmp/.brave-display-${display}.lock`
+
+const isProcessAlive = (pid) => {
+  try {
+    process.kill(pid, 0)
+    return true
+  } catch (e) {
+    return e.code === 'EPERM'
+  }
+}
+
+// Atomically claims a free display from |display| on and returns it.
+const claimDisplay = (display) => {
+  for (;; display++) {
+    if (isDisplayInUse(display)) {
+      continue
+    }
+    const file = claimFile(display)
+    try {
+      fs.writeFileSync(file, String(process.pid), { flag: 'wx' })
+      return display
+    } catch (e) {
+      if (e.code !== 'EEXIST') {
+        throw e
+      }
+    }
+    // The claim of a pool which did not stop, e.g. a killed test run, is
+    // taken over. A claim released meanwhile is tried again.
+    let owner
+    try {
+      owner = parseInt(fs.readFileSync(file, 'utf8'), 10)
+    } catch (e) {
+      owner = null
+    }
+    if (owner === null || (owner && !isProcessAlive(owner))) {
+      if (owner) {
+        fs.removeSync(file)
+      }
+      display--
+    }
+  }
+}
+
+// A pool of isolated environments for running browser test shards side by
+// side on Linux: each slot has its own headless display (an Xvfb server or
+// headless Ozone) and its own temp and XDG dirs. Browser tests create their
+// user data dirs under TMPDIR, so that isolates profiles as well.
+module.exports = class DisplayPool {
+  constructor (kind, size) {
+    if (!['xvfb', 'ozone'].includes(kind)) {
+      throw new Error(`Unknown display pool "${kind}", use xvfb or ozone`)
+    }
+    if (process.platform !== 'linux') {
+      throw new Error('Display pools are only supported on Linux')
+    }
+    this.kind = kind
+    this.size = size
+    this.slots = []
+  }
+
+  async start () {
+    let display = firstDisplay
+    for (let i = 0; i < this.size; i++) {
+      const slot = {
+        tempDir: fs.mkdtempSync(path.join(os.tmpdir(), `brave-test-shard${i}-`))
+      }
+      this.slots.push(slot)
+      if (this.kind === 'xvfb') {
+        slot.display = claimDisplay(display)
+        display = slot.display + 1
+        slot.server = spawn('Xvfb', [`:${slot.display}`, '-screen', '0', xvfbScreen, '-nolisten', 'tcp'], {
+          stdio: 'ignore'
+        })
+      }
+    }
+    await Promise.all(this.slots.filter((slot) => slot.server).map((slot) => this.waitForDisplay(slot)))
+  }
+
+  async waitForDisplay (slot) {
+    let exited = false
+    slot.server.on('exit', () => { exited = true })
+    // e.g. Xvfb is not installed.
+    slot.server.on('error', () => { exited = true })
+    const deadline = Date.now() + displayStartTimeoutMs
+    while (!fs.existsSync(displaySocket(slot.display))) {
+      if (exited || Date.now() > deadline) {
+        throw new Error(`Xvfb could not start display :${slot.display}`)
+      }
+      await sleep(100)
+    }
+  }
+
+  // Environment and extra test arguments for the |index|th slot.
+  slotOptions (index, env) {
+    const slot = this.slots[index]
+    const slotEnv = Object.assign({}, env, {
+      TMPDIR: slot.tempDir,
+      XDG_CONFIG_HOME: path.join(slot.tempDir, 'config'),
+      XDG_CACHE_HOME: path.join(slot.tempDir, 'cache')
+    })
+    if (this.kind === 'xvfb') {
+      slotEnv.DISPLAY = `:${slot.display}`
+      return { env: slotEnv, args: [] }
+    }
+    delete slotEnv.DISPLAY
+    return { env: slotEnv, args: ['--ozone-platform=headless'] }
+  }
+
+  stop () {
+    for (const slot of this.slots) {
+      if (slot.server) {
+        slot.server.kill()
+      }
+      if (slot.display !== undefined) {
+        fs.removeSync(claimFile(slot.display))
+      }
+      fs.removeSync(slot.tempDir)
+    }
+    this.slots = []
+  }
+}
@@ -0,0 +1,99 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Flame graphs of folded stacks ("root;caller;callee count" lines, as
+// written by stackcollapse-perf.pl), rendered to standalone SVG files.
+
+const width = 1200
+const frameHeight = 16
+const fontSize = 11
+const charWidth = fontSize * 0.6
+const margin = 10
+const titleHeight = 30
+// Frames narrower than this many pixels are not drawn.
+const minFrameWidth = 0.1
+
+const escapeXml = (text) => text.replace(/&/g, '&amp;').replace(/</g, '&lt;')
+  .replace(/>/g, '&gt;').replace(/"/g, '&quot;')
+
+// Warm colors, stable for a frame name so that graphs can be compared.
+const frameColor = (name) => {
+  let hash = 0
+  for (let i = 0; i < name.length; i++) {
+    hash = (hash * 31 + name.charCodeAt(i)) >>> 0
+  }
+  return `rgb(${205 + hash % 50},${(hash >>> 8) % 200},${(hash >>> 16) % 55})`
+}
+
+// Tree of frames with the number of samples under each.
+const buildTree = (stacks) => {
+  const root = { name: 'all', value: 0, children: new Map() }
+  for (const [stack, count] of stacks) {
+    root.value += count
+    let node = root
+    for (const frame of stack.split(';')) {
+      if (!node.children.has(frame)) {
+        node.children.set(frame, { name: frame, value: 0, children: new Map() })
+      }
+      node = node.children.get(frame)
+      node.value += count
+    }
+  }
+  return root
+}
+
+// |stacks| is a Map of folded stack to sample count.
+const toSvg = (stacks, title) => {
+  const root = buildTree(stacks)
+  const rects = []
+  let maxDepth = 0
+  const scale = root.value ? (width - 2 * margin) / root.value : 0
+  const layout = (node, x, depth) => {
+    const frameWidth = node.value * scale
+    if (frameWidth < minFrameWidth) {
+      return
+    }
+    maxDepth = Math.max(maxDepth, depth)
+    rects.push({ node, x, depth, frameWidth })
+    let childX = x
+    const children = Array.from(node.children.values()).sort((a, b) => a.name < b.name ? -1 : 1)
+    for (const child of children) {
+      layout(child, childX, depth + 1)
+      childX += child.value * scale
+    }
+  }
+  layout(root, margin, 0)
+
+  const height = titleHeight + (maxDepth + 1) * frameHeight + margin
+  const lines = [
+    '<?xml version="1.0" standalone="no"?>',
+    `<svg version="1.1" width="${width}" height="${height}" xmlns="http://www.w3.org/2000/svg" font-family="Verdana, sans-serif" font-size="${fontSize}">`,
+    `<rect x="0" y="0" width="${width}" height="${height}" fill="#f8f8f8"/>`,
+    `<text x="${width / 2}" y="20" text-anchor="middle" font-size="${fontSize + 5}">${escapeXml(title)}</text>`
+  ]
+  for (const { node, x, depth, frameWidth } of rects) {
+    // The root is at the bottom, as in the usual flame graphs.
+    const y = height - margin - (depth + 1) * frameHeight
+    const percent = (100 * node.value / root.value).toFixed(2)
+    const label = `${node.name} (${node.value} samples, ${percent}%)`
+    const chars = Math.floor((frameWidth - 6) / charWidth)
+    const text = chars < 3 ? '' : node.name.length <= chars ? node.name : node.name.substring(0, chars - 2) + '..'
+    lines.push(`<g><title>${escapeXml(label)}</title>` +
+      `<rect x="${x.toFixed(1)}" y="${y}" width="${frameWidth.toFixed(1)}" height="${frameHeight - 1}" fill="${depth ? frameColor(node.name) : '#ccc'}" rx="2"/>` +
+      (text ? `<text x="${(x + 3).toFixed(1)}" y="${y + fontSize}">${escapeXml(text)}</text>` : '') + '</g>')
+  }
+  lines.push('</svg>')
+  return lines.join('\n')
+}
+
+const toFolded = (stacks) => Array.from(stacks)
+  .sort((a, b) => a[0] < b[0] ? -1 : 1)
+  .map(([stack, count]) => `${stack} ${count}`)
+  .join('\n') + '\n'
+
+module.exports = {
+  toSvg,
+  toFolded
+}
@@ -0,0 +1,252 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const os = require('os')
+const fs = require('fs-extra')
+const config = require('../lib/config')
+const util = require('../lib/util')
+
+// Only compiler and linker products are candidates for stale output removal.
+// gn also writes files into the out dir (.ninja files, runtime_deps,
+// build_config json, ...) which are not outputs of any ninja edge.
+const staleOutputExtensions = [
+  '.o', '.obj', '.a', '.lib', '.rlib', '.so', '.dylib', '.dll', '.pdb', '.ilk'
+]
+const staleOutputDirs = ['obj']
+
+const sizeUnits = { K: 1024, M: 1024 ** 2, G: 1024 ** 3, T: 1024 ** 4 }
+
+// Parses sizes such as '500G', '1.5T' or a plain number of bytes.
+const parseSize = (size) => {
+  if (typeof size === 'number') {
+    return size
+  }
+  const match = /^\s*(\d+(?:\.\d+)?)\s*([KMGT])?i?B?\s*$/i.exec(size || '')
+  if (!match) {
+    throw new Error(`Invalid size "${size}". Use a size like 200G.`)
+  }
+  const unit = match[2] ? sizeUnits[match[2].toUpperCase()] : 1
+  return Math.floor(parseFloat(match[1]) * unit)
+}
+
+const formatSize = (bytes) => {
+  for (const unit of ['T', 'G', 'M', 'K']) {
+    if (bytes >= sizeUnits[unit]) {
+      return (bytes / sizeUnits[unit]).toFixed(1) + unit
+    }
+  }
+  return bytes + 'B'
+}
+
+// `ninja -t targets all` prints one "<output>: <rule>" line per output.
+const parseNinjaTargets = (output) => {
+  const targets = new Set()
+  for (const line of output.split(/\r?\n/)) {
+    const separatorIndex = line.lastIndexOf(': ')
+    if (separatorIndex > 0) {
+      targets.add(line.substring(0, separatorIndex).replace(/\\/g, '/'))
+    }
+  }
+  return targets
+}
+
+const isStaleOutputCandidate = (relativePath) => {
+  const normalized = relativePath.replace(/\\/g, '/')
+  return staleOutputDirs.some((dir) => normalized.startsWith(dir + '/')) &&
+    staleOutputExtensions.includes(path.extname(normalized))
+}
+
+// Returns the files under |outputDir| which look like build products but are
+// not produced by any edge of the current ninja graph.
+const findStaleOutputs = (outputDir, targets) => {
+  const stale = []
+  for (const dir of staleOutputDirs) {
+    const fullDir = path.join(outputDir, dir)
+    if (!fs.existsSync(fullDir)) {
+      continue
+    }
+    for (const file of util.walkSync(fullDir)) {
+      const relativePath = path.relative(outputDir, file).replace(/\\/g, '/')
+      if (isStaleOutputCandidate(relativePath) && !targets.has(relativePath)) {
+        stale.push(relativePath)
+      }
+    }
+  }
+  return stale
+}
+
+const diskUsage = (dir) => {
+  let total = 0
+  let entries
+  try {
+    entries = fs.readdirSync(dir, { withFileTypes: true })
+  } catch (e) {
+    return 0
+  }
+  for (const entry of entries) {
+    const entryPath = path.join(dir, entry.name)
+    if (entry.isDirectory()) {
+      total += diskUsage(entryPath)
+    } else {
+      try {
+        total += fs.lstatSync(entryPath).size
+      } catch (e) {}
+    }
+  }
+  return total
+}
+
+// Every gn out dir has an args.gn, and .ninja_log is rewritten by each build,
+// which makes its mtime a cheap last-used timestamp.
+const listOutputDirs = () => {
+  const baseDir = path.join(config.srcDir, 'out')
+  if (!fs.existsSync(baseDir)) {
+    return []
+  }
+  return fs.readdirSync(baseDir)
+    .map((name) => path.join(baseDir, name))
+    .filter((dir) => fs.existsSync(path.join(dir, 'args.gn')))
+}
+
+const lastUsed = (dir, stampFile) => {
+  const stamp = path.join(dir, stampFile)
+  return (fs.existsSync(stamp) ? fs.statSync(stamp) : fs.statSync(dir)).mtimeMs
+}
+
+const getCompileCache = () => {
+  if (!config.sccache) {
+    return null
+  }
+  if (path.basename(config.sccache) === 'ccache') {
+    const dir = process.env.CCACHE_DIR || path.join(os.homedir(), '.ccache')
+    return { kind: 'ccache', dir, stampFile: 'stats' }
+  }
+  if (process.env.SCCACHE_BUCKET) {
+    // Remote cache, nothing to reclaim locally.
+    return null
+  }
+  let dir = process.env.SCCACHE_DIR
+  if (!dir) {
+    if (process.platform === 'win32') {
+      dir = path.join(process.env.LocalAppData, 'Mozilla', 'sccache')
+    } else if (process.platform === 'darwin') {
+      dir = path.join(os.homedir(), 'Library', 'Caches', 'Mozilla.sccache')
+    } else {
+      dir = path.join(os.homedir(), '.cache', 'sccache')
+    }
+  }
+  return { kind: 'sccache', dir, stampFile: '.' }
+}
+
+// Walks |entries| from most to least recently used and returns the ones which
+// do not fit in |budget|. Entries marked |pinned| are always kept and count
+// against the budget first.
+const selectEvictions = (entries, budget) => {
+  let used = entries.filter((entry) => entry.pinned)
+    .reduce((total, entry) => total + entry.size, 0)
+  const evictions = []
+  const candidates = entries.filter((entry) => !entry.pinned)
+    .sort((a, b) => b.lastUsed - a.lastUsed)
+  for (const entry of candidates) {
+    if (used + entry.size <= budget) {
+      used += entry.size
+    } else {
+      evictions.push(Object.assign({}, entry, { remaining: Math.max(budget - used, 0) }))
+    }
+  }
+  return evictions
+}
+
+const removeStaleOutputs = (outputDir, dryRun) => {
+  console.log('collecting stale outputs in ' + outputDir + '...')
+  const options = config.defaultOptions
+  if (!dryRun) {
+    // Removes files recorded in .ninja_log which are no longer in the graph.
+    util.run('ninja', ['-C', outputDir, '-t', 'cleandead'], Object.assign({}, options, { continueOnFail: true }))
+  }
+  const prog = util.run('ninja', ['-C', outputDir, '-t', 'targets', 'all'],
+    Object.assign({}, options, { stdio: 'pipe', maxBuffer: 1024 * 1024 * 1024 }))
+  const stale = findStaleOutputs(outputDir, parseNinjaTargets(prog.stdout.toString()))
+  let reclaimed = 0
+  for (const file of stale) {
+    const fullPath = path.join(outputDir, file)
+    reclaimed += fs.statSync(fullPath).size
+    if (!dryRun) {
+      fs.unlinkSync(fullPath)
+    }
+  }
+  console.log(`${dryRun ? 'would remove' : 'removed'} ${stale.length} stale outputs (${formatSize(reclaimed)})`)
+}
+
+const evict = (entry, dryRun) => {
+  console.log(`${dryRun ? 'would evict' : 'evicting'} ${entry.dir} (${formatSize(entry.size)}, last used ${new Date(entry.lastUsed).toISOString()})`)
+  if (dryRun) {
+    return
+  }
+  if (entry.cache && entry.cache.kind === 'ccache') {
+    // Let ccache drop its own least recently used entries down to what is
+    // left. The limit only holds for this cleanup, through the environment,
+    // so the max_size of the user's ccache configuration stays as it is.
+    // ccache treats a max_size of 0 as unlimited, so with less than 1 KiB
+    // left the cache is cleared instead.
+    const options = config.defaultOptions
+    if (entry.remaining < 1024) {
+      util.run(config.sccache, ['--clear'], options)
+    } else {
+      options.env.CCACHE_MAXSIZE = `${Math.floor(entry.remaining / 1024)}Ki`
+      util.run(config.sccache, ['--cleanup'], options)
+    }
+  } else if (entry.cache) {
+    // A running sccache server would keep writing to the emptied dir.
+    util.run(config.sccache, ['--stop-server'], Object.assign({}, config.defaultOptions, { continueOnFail: true }))
+    fs.emptyDirSync(entry.dir)
+  } else {
+    fs.removeSync(entry.dir)
+  }
+}
+
+const gcOut = (buildConfig = config.defaultBuildConfig, options) => {
+  config.buildConfig = buildConfig
+  config.update(options)
+
+  const outputDirs = options.all ? listOutputDirs() : [config.outputDir]
+  for (const outputDir of outputDirs) {
+    if (fs.existsSync(path.join(outputDir, 'build.ninja'))) {
+      removeStaleOutputs(outputDir, options.dry_run)
+    }
+  }
+
+  if (!config.gcOutBudget) {
+    return
+  }
+  const budget = parseSize(config.gcOutBudget)
+  const entries = listOutputDirs().map((dir) => ({
+    dir,
+    size: diskUsage(dir),
+    lastUsed: lastUsed(dir, '.ninja_log'),
+    pinned: path.resolve(dir) === path.resolve(config.outputDir)
+  }))
+  const cache = getCompileCache()
+  if (cache && fs.existsSync(cache.dir)) {
+    entries.push({
+      dir: cache.dir,
+      size: diskUsage(cache.dir),
+      lastUsed: lastUsed(cache.dir, cache.stampFile),
+      cache
+    })
+  }
+  const total = entries.reduce((sum, entry) => sum + entry.size, 0)
+  console.log(`out dirs and compile cache use ${formatSize(total)} of a ${formatSize(budget)} budget`)
+  selectEvictions(entries, budget).forEach((entry) => evict(entry, options.dry_run))
+}
+
+module.exports = Object.assign(gcOut, {
+  parseSize,
+  formatSize,
+  parseNinjaTargets,
+  isStaleOutputCandidate,
+  selectEvictions
+})
@@ -0,0 +1,41 @@
+const gcOut = require('./gcOut')
+
+test('parses disk budgets', function () {
+  expect(gcOut.parseSize('1024')).toBe(1024)
+  expect(gcOut.parseSize('2K')).toBe(2048)
+  expect(gcOut.parseSize('1.5G')).toBe(1.5 * 1024 * 1024 * 1024)
+  expect(gcOut.parseSize('300GB')).toBe(300 * 1024 * 1024 * 1024)
+  expect(() => gcOut.parseSize('lots')).toThrow()
+})
+
+test('parses ninja target listings', function () {
+  const targets = gcOut.parseNinjaTargets([
+    'obj/brave/browser/browser/brave_browser_main_parts.o: cxx',
+    'brave: link',
+    'all: phony',
+    ''
+  ].join('\n'))
+  expect(targets.has('obj/brave/browser/browser/brave_browser_main_parts.o')).toBe(true)
+  expect(targets.has('brave')).toBe(true)
+  expect(targets.size).toBe(3)
+})
+
+test('only considers compiler and linker products as stale', function () {
+  expect(gcOut.isStaleOutputCandidate('obj/brave/foo/bar.o')).toBe(true)
+  expect(gcOut.isStaleOutputCandidate('obj/brave/foo/libbar.a')).toBe(true)
+  expect(gcOut.isStaleOutputCandidate('obj/brave/foo/bar.ninja')).toBe(false)
+  expect(gcOut.isStaleOutputCandidate('gen/brave/foo/bar.o')).toBe(false)
+  expect(gcOut.isStaleOutputCandidate('args.gn')).toBe(false)
+})
+
+test('evicts least recently used entries beyond the budget', function () {
+  const entries = [
+    { dir: 'out/Debug', size: 50, lastUsed: 1, pinned: true },
+    { dir: 'out/Release', size: 30, lastUsed: 3 },
+    { dir: 'out/android_Release_arm', size: 30, lastUsed: 2 },
+    { dir: 'cache', size: 10, lastUsed: 4 }
+  ]
+  const evictions = gcOut.selectEvictions(entries, 100)
+  expect(evictions.map((entry) => entry.dir)).toEqual(['out/android_Release_arm'])
+  expect(evictions[0].remaining).toBe(10)
+})
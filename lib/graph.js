@@ -0,0 +1,50 @@
+const config = require('../lib/config')
+const BuildGraph = require('./buildGraph')
+
+const isLabel = (item) => item.startsWith('//') && item.includes(':')
+
+// Resolves a mix of labels and files into the labels of the targets which
+// contain them.
+const resolveLabels = (buildGraph, items) => {
+  const labels = new Set()
+  for (const item of items) {
+    const resolved = isLabel(item) ? [item] : buildGraph.targetsForFile(item)
+    if (!resolved.length) {
+      console.warn(`${item} is not part of any target`)
+    }
+    resolved.forEach((label) => labels.add(label))
+  }
+  return [...labels]
+}
+
+const queries = {
+  files: (buildGraph, items) => resolveLabels(buildGraph, items),
+  rdeps: (buildGraph, items) => [...buildGraph.closure(resolveLabels(buildGraph, items))],
+  deps: (buildGraph, items) => [...buildGraph.closure(resolveLabels(buildGraph, items), true)],
+  tests: (buildGraph, items) => buildGraph.testsFor(resolveLabels(buildGraph, items))
+}
+
+const graph = (query, items = [], options) => {
+  config.buildConfig = options.build_config || config.defaultBuildConfig
+  config.update(options)
+
+  const buildGraph = new BuildGraph(config.outputDir)
+  if (query === 'update') {
+    buildGraph.update(true)
+    return
+  }
+  if (!queries[query]) {
+    console.error(`Unknown query "${query}". Available queries: update, ${Object.keys(queries).join(', ')}`)
+    process.exit(1)
+  }
+  // Cheap when nothing changed: only the gn input files are stat'ed.
+  buildGraph.update()
+  const results = queries[query](buildGraph, items).sort()
+  if (options.json) {
+    console.log(JSON.stringify(results, null, 2))
+  } else {
+    results.forEach((result) => console.log(result))
+  }
+}
+
+module.exports = graph
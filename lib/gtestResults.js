@@ -0,0 +1,148 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const fs = require('fs-extra')
+
+// Reads and writes the XML written by test binaries for --gtest_output=xml,
+// which is also what the CI xunit GoogleTest parser consumes.
+
+const xmlEntities = {
+  '&lt;': '<',
+  '&gt;': '>',
+  '&quot;': '"',
+  '&apos;': '\'',
+  '&#10;': '\n',
+  '&#13;': '\r',
+  '&amp;': '&'
+}
+
+const unescapeXml = (text) => text.replace(/&(lt|gt|quot|apos|#10|#13|amp);/g, (entity) => xmlEntities[entity])
+
+const escapeXml = (text) => String(text)
+  .replace(/&/g, '&amp;')
+  .replace(/</g, '&lt;')
+  .replace(/>/g, '&gt;')
+  .replace(/"/g, '&quot;')
+  .replace(/\n/g, '&#10;')
+  .replace(/\r/g, '&#13;')
+
+const parseAttributes = (tag) => {
+  const attributes = {}
+  const attributeRegex = /([\w:-]+)="([^"]*)"/g
+  let match
+  while ((match = attributeRegex.exec(tag)) !== null) {
+    attributes[match[1]] = unescapeXml(match[2])
+  }
+  return attributes
+}
+
+// Returns one entry per <testcase>:
+// { suite, name, time, status, result, failures: [{ message, type, text }], properties }
+// where |properties| holds any other attribute of the testcase.
+const parse = (xml) => {
+  const tests = []
+  const testCaseRegex = /<testcase\b([^>]*?)(\/>|>([\s\S]*?)<\/testcase>)/g
+  let match
+  while ((match = testCaseRegex.exec(xml)) !== null) {
+    const { name, classname, time, status, result, ...properties } = parseAttributes(match[1])
+    const failures = []
+    const failureRegex = /<failure\b([^>]*?)(\/>|>([\s\S]*?)<\/failure>)/g
+    let failure
+    while ((failure = failureRegex.exec(match[3] || '')) !== null) {
+      const { message = '', type = '' } = parseAttributes(failure[1])
+      failures.push({
+        message,
+        type,
+        text: unescapeXml((failure[3] || '').replace(/^<!\[CDATA\[|\]\]>$/g, ''))
+      })
+    }
+    tests.push({
+      suite: classname,
+      name,
+      time: parseFloat(time) || 0,
+      status: status || 'run',
+      result: result || 'completed',
+      failures,
+      properties
+    })
+  }
+  return tests
+}
+
+const read = (file) => parse(fs.readFileSync(file, 'utf8'))
+
+const fullName = (test) => `${test.suite}.${test.name}`
+
+const isFailure = (test) => test.failures.length > 0
+
+const serializeTest = (test) => {
+  const attributes = Object.assign({
+    name: test.name,
+    status: test.status,
+    result: test.result,
+    time: test.time.toFixed(3),
+    classname: test.suite
+  }, test.properties)
+  const attributeString = Object.keys(attributes)
+    .map((key) => `${key}="${escapeXml(attributes[key])}"`).join(' ')
+  if (!test.failures.length) {
+    return `    <testcase ${attributeString} />`
+  }
+  const failures = test.failures.map((failure) =>
+    `      <failure message="${escapeXml(failure.message)}" type="${escapeXml(failure.type)}">${escapeXml(failure.text)}</failure>`)
+  return [`    <testcase ${attributeString}>`, ...failures, '    </testcase>'].join('\n')
+}
+
+// Serializes |tests| grouped by suite, in first-seen order.
+const serialize = (tests) => {
+  const suites = new Map()
+  for (const test of tests) {
+    if (!suites.has(test.suite)) {
+      suites.set(test.suite, [])
+    }
+    suites.get(test.suite).push(test)
+  }
+  const summary = (suiteTests) => {
+    const failures = suiteTests.filter(isFailure).length
+    const disabled = suiteTests.filter((test) => test.status === 'notrun').length
+    const time = suiteTests.reduce((total, test) => total + test.time, 0)
+    return `tests="${suiteTests.length}" failures="${failures}" disabled="${disabled}" errors="0" time="${time.toFixed(3)}"`
+  }
+  const lines = [
+    '<?xml version="1.0" encoding="UTF-8"?>',
+    `<testsuites name="AllTests" ${summary(tests)}>`
+  ]
+  for (const [suite, suiteTests] of suites) {
+    lines.push(`  <testsuite name="${escapeXml(suite)}" ${summary(suiteTests)}>`)
+    suiteTests.forEach((test) => lines.push(serializeTest(test)))
+    lines.push('  </testsuite>')
+  }
+  lines.push('</testsuites>', '')
+  return lines.join('\n')
+}
+
+// Merges several result files into |outputFile|. A test reported more than
+// once keeps its last result.
+const merge = (inputFiles, outputFile) => {
+  const tests = new Map()
+  for (const file of inputFiles) {
+    if (!fs.existsSync(file)) {
+      console.warn(`Missing test results file ${file}`)
+      continue
+    }
+    read(file).forEach((test) => tests.set(fullName(test), test))
+  }
+  fs.writeFileSync(outputFile, serialize([...tests.values()]))
+  return [...tests.values()]
+}
+
+module.exports = {
+  parse,
+  read,
+  serialize,
+  merge,
+  fullName,
+  isFailure
+}
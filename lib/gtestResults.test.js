@@ -0,0 +1,64 @@
+const path = require('path')
+const fs = require('fs-extra')
+const os = require('os')
+const gtestResults = require('./gtestResults')
+
+const dirPrefixTmp = 'brave-browser-test-gtest-results-'
+let testDirPath
+
+const shard0 = `<?xml version="1.0" encoding="UTF-8"?>
+<testsuites name="AllTests" tests="2" failures="1" disabled="0" errors="0" time="1.5">
+  <testsuite name="AdBlockServiceTest" tests="2" failures="1" disabled="0" errors="0" time="1.5">
+    <testcase name="AdsGetBlocked" status="run" result="completed" time="1.2" classname="AdBlockServiceTest" />
+    <testcase name="Cosmetic" status="run" result="completed" time="0.3" classname="AdBlockServiceTest">
+      <failure message="Value of: x &amp;&amp; y&#10;  Actual: false" type=""><![CDATA[brave/browser/ad_block_service_browsertest.cc:42]]></failure>
+    </testcase>
+  </testsuite>
+</testsuites>
+`
+const shard1 = `<?xml version="1.0" encoding="UTF-8"?>
+<testsuites name="AllTests" tests="1" failures="0" disabled="0" errors="0" time="2">
+  <testsuite name="BraveRewardsTest" tests="1" failures="0" disabled="0" errors="0" time="2">
+    <testcase name="ClaimGrant" status="run" result="completed" time="2" classname="BraveRewardsTest" />
+  </testsuite>
+</testsuites>
+`
+
+beforeEach(async function () {
+  testDirPath = await fs.mkdtemp(path.join(os.tmpdir(), dirPrefixTmp))
+})
+
+afterEach(async function () {
+  await fs.remove(testDirPath)
+})
+
+test('parses test cases and failures', function () {
+  const tests = gtestResults.parse(shard0)
+  expect(tests).toHaveLength(2)
+  expect(gtestResults.fullName(tests[0])).toBe('AdBlockServiceTest.AdsGetBlocked')
+  expect(tests[0].time).toBe(1.2)
+  expect(gtestResults.isFailure(tests[0])).toBe(false)
+  expect(gtestResults.isFailure(tests[1])).toBe(true)
+  expect(tests[1].failures[0].message).toBe('Value of: x && y\n  Actual: false')
+  expect(tests[1].failures[0].text).toBe('brave/browser/ad_block_service_browsertest.cc:42')
+})
+
+test('serialized results parse back to the same tests', function () {
+  const tests = gtestResults.parse(shard0)
+  expect(gtestResults.parse(gtestResults.serialize(tests))).toEqual(tests)
+})
+
+test('merges shard results into one report', async function () {
+  const files = [path.join(testDirPath, 'shard0.xml'), path.join(testDirPath, 'shard1.xml')]
+  await fs.writeFile(files[0], shard0)
+  await fs.writeFile(files[1], shard1)
+  const output = path.join(testDirPath, 'merged.xml')
+  gtestResults.merge(files, output)
+  const merged = await fs.readFile(output, 'utf8')
+  expect(merged).toContain('<testsuites name="AllTests" tests="3" failures="1"')
+  expect(gtestResults.parse(merged).map(gtestResults.fullName)).toEqual([
+    'AdBlockServiceTest.AdsGetBlocked',
+    'AdBlockServiceTest.Cosmetic',
+    'BraveRewardsTest.ClaimGrant'
+  ])
+})
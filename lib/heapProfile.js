@@ -0,0 +1,381 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const os = require('os')
+const fs = require('fs-extra')
+const { spawnSync } = require('child_process')
+const BrowserProcess = require('./browserProcess')
+const DevToolsPipe = require('./devtoolsPipe')
+const { withBenchmarkEnvironment } = require('./startupBenchmark')
+const { withReplayServer, openTab, hasFramePointers } = require('./benchmarkProfile')
+
+const { sleep } = BrowserProcess
+
+const startupSettleMs = 10000
+const pageSettleMs = 5000
+const closedSettleMs = 10000
+const dumpTimeoutMs = 2 * 60000
+const traceTimeoutMs = 5 * 60000
+const maxPages = 10
+const reportedSites = 200
+const printedSites = 20
+
+// Out-of-process heap profiling of the browser, renderer, GPU and utility
+// processes with native stacks, sampling one allocation per |samplingBytes|
+// allocated on average. Builds before sampling was the default need
+// --memlog-sampling to sample at all.
+const heapProfilingArgs = (samplingBytes) => [
+  '--memlog=all',
+  '--memlog-stack-mode=native-with-thread-names',
+  '--memlog-sampling',
+  `--memlog-sampling-rate=${samplingBytes}`
+]
+
+// Heap dumps are only added to traces of this category.
+const traceConfig = {
+  includedCategories: ['disabled-by-default-memory-infra'],
+  excludedCategories: ['*'],
+  // Only the dumps requested below.
+  memoryDumpConfig: { triggers: [] }
+}
+
+// Parses the memory dump events of |traceEvents| into the dumps in the
+// order they were taken, each a Map of pid to its allocations, with the
+// stack frame maps and memory maps of every process. Processes only send
+// the entries of their maps which are new since their previous dump.
+const parseHeapDumps = (traceEvents) => {
+  const processNames = new Map()
+  const maps = new Map()
+  const regions = new Map()
+  const dumps = new Map()
+  for (const event of traceEvents) {
+    if (event.ph === 'M' && event.name === 'process_name') {
+      processNames.set(event.pid, event.args.name)
+    }
+  }
+  const dumpEvents = traceEvents.filter((event) => event.ph === 'v' && event.args && event.args.dumps)
+    .sort((a, b) => a.ts - b.ts)
+  for (const event of dumpEvents) {
+    const { heaps_v2: heaps, process_mmaps: mmaps } = event.args.dumps
+    if (mmaps && mmaps.vm_regions) {
+      regions.set(event.pid, mmaps.vm_regions)
+    }
+    if (!heaps) {
+      continue
+    }
+    if (!maps.has(event.pid)) {
+      maps.set(event.pid, { nodes: new Map(), strings: new Map() })
+    }
+    const processMaps = maps.get(event.pid)
+    for (const entry of (heaps.maps && heaps.maps.strings) || []) {
+      processMaps.strings.set(entry.id, entry.string)
+    }
+    for (const node of (heaps.maps && heaps.maps.nodes) || []) {
+      processMaps.nodes.set(node.id, { parent: node.parent, name: node.name_sid })
+    }
+    const allocations = []
+    for (const [allocator, entries] of Object.entries(heaps.allocators || {})) {
+      for (let i = 0; i < entries.nodes.length; i++) {
+        allocations.push({ allocator, node: entries.nodes[i], count: entries.counts[i], size: entries.sizes[i] })
+      }
+    }
+    if (!dumps.has(event.id)) {
+      dumps.set(event.id, new Map())
+    }
+    dumps.get(event.id).set(event.pid, allocations)
+  }
+  return { processNames, maps, regions, dumps: Array.from(dumps.values()) }
+}
+
+// The frame names of the stack of |nodeId|, innermost first.
+const stackOf = (processMaps, nodeId) => {
+  const frames = []
+  for (let node = processMaps.nodes.get(nodeId); node; node = processMaps.nodes.get(node.parent)) {
+    frames.push(processMaps.strings.get(node.name))
+  }
+  return frames
+}
+
+const parseHex = (value) => BigInt(/^0x/i.test(value) ? value : '0x' + value)
+
+// Maps the native frames ("pc:<hex>") of every process to the module which
+// contains them and the offset in it, from the memory maps of the process.
+// Modules are mapped from their start, so their lowest mapping is their
+// load address.
+const moduleOffsets = (maps, regions) => {
+  const offsets = new Map()
+  for (const [pid, processMaps] of maps) {
+    const moduleRegions = (regions.get(pid) || []).filter((region) => region.mf)
+      .map((region) => ({ file: region.mf, start: parseHex(region.sa), end: parseHex(region.sa) + parseHex(region.sz) }))
+    const loadAddresses = new Map()
+    for (const region of moduleRegions) {
+      if (!loadAddresses.has(region.file) || region.start < loadAddresses.get(region.file)) {
+        loadAddresses.set(region.file, region.start)
+      }
+    }
+    const pidOffsets = new Map()
+    for (const name of processMaps.strings.values()) {
+      if (typeof name !== 'string' || !name.startsWith('pc:')) {
+        continue
+      }
+      const pc = parseHex(name.substring(3))
+      const region = moduleRegions.find((candidate) => pc >= candidate.start && pc < candidate.end)
+      if (region) {
+        pidOffsets.set(name, { file: region.file, offset: pc - loadAddresses.get(region.file) })
+      }
+    }
+    offsets.set(pid, pidOffsets)
+  }
+  return offsets
+}
+
+// llvm-symbolizer of the Chromium toolchain, or addr2line. Both print the
+// function and then the location of every address read from stdin.
+const symbolizerCommand = (srcDir) => {
+  const llvmSymbolizer = path.join(srcDir, 'third_party', 'llvm-build', 'Release+Asserts', 'bin', 'llvm-symbolizer')
+  if (fs.existsSync(llvmSymbolizer)) {
+    return (file) => [llvmSymbolizer, ['--functions=linkage', '--demangle', '--inlining=false', '--obj=' + file]]
+  }
+  return (file) => ['addr2line', ['-f', '-C', '-e', file]]
+}
+
+// Symbolizes |offsets|, a Map of module file to the offsets in it, against
+// the binaries the browser ran. Resolves to a Map of "file:offset" to
+// { function, location }.
+const symbolize = (offsets, srcDir) => {
+  const command = symbolizerCommand(srcDir)
+  const symbols = new Map()
+  for (const [file, fileOffsets] of offsets) {
+    if (!fs.existsSync(file)) {
+      continue
+    }
+    const list = Array.from(fileOffsets)
+    const [program, args] = command(file)
+    const symbolizer = spawnSync(program, args, {
+      input: list.map((offset) => '0x' + offset.toString(16)).join('\n') + '\n',
+      maxBuffer: 256 * 1024 * 1024
+    })
+    if (symbolizer.error || symbolizer.status !== 0) {
+      throw new Error(`Could not symbolize ${file}: ` +
+        (symbolizer.error ? symbolizer.error.message : symbolizer.stderr.toString()))
+    }
+    const lines = symbolizer.stdout.toString().split('\n').filter((line) => line)
+    list.forEach((offset, i) => {
+      symbols.set(`${file}:${offset}`, { function: lines[2 * i], location: lines[2 * i + 1] })
+    })
+  }
+  return symbols
+}
+
+// Source location of |location| ("file:line[:column]", with the file as
+// the compiler saw it from |outDir|) relative to |srcDir| if it is under
+// brave/, null otherwise.
+const braveSource = (location, srcDir, outDir) => {
+  const match = /^(.*?):(\d+)/.exec(location || '')
+  if (!match || match[1] === '??') {
+    return null
+  }
+  const relative = path.relative(srcDir, path.resolve(outDir, match[1]))
+  return relative.split(path.sep)[0] === 'brave' ? `${relative.split(path.sep).join('/')}:${match[2]}` : null
+}
+
+// Attributes the allocations of every process of |dump| to the innermost
+// frame of their stack in Brave code. |resolveFrame(pid, name)| returns
+// { function, source } for a frame name, with source null outside of
+// brave/. Returns the sampled bytes of every process and the bytes by site.
+const attributeDump = (dump, maps, resolveFrame) => {
+  const processes = new Map()
+  const sites = new Map()
+  for (const [pid, allocations] of dump) {
+    const totals = { bytes: 0, brave_bytes: 0 }
+    processes.set(pid, totals)
+    for (const allocation of allocations) {
+      totals.bytes += allocation.size
+      for (const name of stackOf(maps.get(pid), allocation.node)) {
+        const frame = resolveFrame(pid, name)
+        if (frame && frame.source) {
+          totals.brave_bytes += allocation.size
+          const key = `${pid} ${frame.source}`
+          const site = sites.get(key) || { pid, function: frame.function, source: frame.source, bytes: 0, count: 0 }
+          site.bytes += allocation.size
+          site.count += allocation.count
+          sites.set(key, site)
+          break
+        }
+      }
+    }
+  }
+  return { processes, sites }
+}
+
+// Builds the report of the dumps taken at |stepNames|: the sampled bytes of
+// every process type and the top allocation sites in Brave code by process
+// type, with their bytes at each step and their growth from the first step
+// to the last.
+const heapReport = (dumps, stepNames, processNames, maps, resolveFrame) => {
+  const typeOf = (pid) => processNames.get(pid) || `pid ${pid}`
+  const steps = []
+  const sites = new Map()
+  dumps.forEach((dump, i) => {
+    const step = stepNames[i] || `dump ${i + 1}`
+    const attributed = attributeDump(dump, maps, resolveFrame)
+    const processTypes = {}
+    for (const [pid, totals] of attributed.processes) {
+      const type = processTypes[typeOf(pid)] || (processTypes[typeOf(pid)] = { processes: 0, bytes: 0, brave_bytes: 0 })
+      type.processes++
+      type.bytes += totals.bytes
+      type.brave_bytes += totals.brave_bytes
+    }
+    steps.push({ step, process_types: processTypes })
+    for (const site of attributed.sites.values()) {
+      const key = `${typeOf(site.pid)} ${site.source}`
+      const entry = sites.get(key) ||
+        { process_type: typeOf(site.pid), function: site.function, source: site.source, bytes: {}, count: {} }
+      entry.bytes[step] = (entry.bytes[step] || 0) + site.bytes
+      entry.count[step] = (entry.count[step] || 0) + site.count
+      sites.set(key, entry)
+    }
+  })
+  const first = steps.length ? steps[0].step : null
+  const last = steps.length ? steps[steps.length - 1].step : null
+  const topSites = Array.from(sites.values()).map((site) =>
+    Object.assign(site, { growth_bytes: (site.bytes[last] || 0) - (site.bytes[first] || 0) }))
+    .sort((a, b) => (b.bytes[last] || 0) - (a.bytes[last] || 0))
+    .slice(0, reportedSites)
+  return { steps, sites: topSites }
+}
+
+const requestDump = async (devtools, step) => {
+  console.log(`Dumping the heaps at ${step}...`)
+  const dump = await devtools.send('Tracing.requestMemoryDump', {}, undefined, dumpTimeoutMs)
+  if (!dump.success) {
+    console.log(`The heap dump at ${step} was incomplete`)
+  }
+}
+
+// Launches |binary| with |args| and out-of-process heap profiling, sampling
+// every |options.samplingBytes|, and dumps the heaps of all processes after
+// startup, with the pages of |options.corpus| (or synthetic pages) open,
+// and after closing them again. Then symbolizes the dumps against the out
+// dir and writes the top allocation sites in Brave code to heap-report.json
+// in |options.outputDir|, with the trace for chrome://tracing. Linux only.
+const heapProfile = async (binary, args, options) => {
+  if (process.platform !== 'linux') {
+    throw new Error('Heap profiling is only supported on Linux')
+  }
+  if (!hasFramePointers(options.buildArgs)) {
+    console.log('This build has no frame pointers, so native stacks stop at the first frame without one. ' +
+      'Build with --debug_build=true (enable_profiling) for full allocation stacks.')
+  }
+  fs.emptyDirSync(options.outputDir)
+  const runDir = fs.mkdtempSync(path.join(os.tmpdir(), 'brave-heap-profile-'))
+  if (options.profile) {
+    fs.copySync(options.profile, path.join(runDir, 'profile'))
+  }
+
+  const stepNames = []
+  const traceEvents = []
+  try {
+    await withReplayServer(options.corpus, async (server) => {
+      const pages = server.archive.pages.slice(0, maxPages)
+      const profileArgs = args.concat(heapProfilingArgs(options.samplingBytes), server.browserArgs(),
+        ['--remote-debugging-pipe', '--user-data-dir=' + path.join(runDir, 'profile')])
+      await withBenchmarkEnvironment(profileArgs, async (benchArgs, env) => {
+        const browser = new BrowserProcess(binary, benchArgs, { env, stdio: DevToolsPipe.pipeStdio })
+        const devtools = new DevToolsPipe(browser)
+        const onData = (params) => {
+          for (const event of params.value) {
+            traceEvents.push(event)
+          }
+        }
+        devtools.on('Tracing.dataCollected', onData)
+        try {
+          await devtools.send('Browser.getVersion')
+          await devtools.send('Tracing.start', { transferMode: 'ReportEvents', traceConfig })
+          const dumpAt = async (step) => {
+            await requestDump(devtools, step)
+            stepNames.push(step)
+          }
+
+          await sleep(startupSettleMs)
+          await dumpAt('startup')
+          const tabs = []
+          for (const url of pages) {
+            tabs.push(await openTab(devtools, url))
+          }
+          await sleep(pageSettleMs)
+          await dumpAt('pages_open')
+          for (const tab of tabs) {
+            await devtools.send('Target.closeTarget', { targetId: tab.targetId })
+          }
+          await sleep(closedSettleMs)
+          await dumpAt('pages_closed')
+
+          const complete = devtools.waitForEvent('Tracing.tracingComplete', undefined, traceTimeoutMs)
+          await devtools.send('Tracing.end')
+          if (!await complete) {
+            throw new Error(`The trace was not complete after ${traceTimeoutMs / 1000}s`)
+          }
+        } finally {
+          devtools.removeListener('Tracing.dataCollected', onData)
+          await devtools.send('Browser.close', {}, undefined, 5000).catch(() => {})
+          await browser.stop()
+        }
+      })
+    })
+  } finally {
+    fs.removeSync(runDir)
+  }
+  fs.writeJsonSync(path.join(options.outputDir, 'trace.json'), { traceEvents })
+
+  const { processNames, maps, regions, dumps } = parseHeapDumps(traceEvents)
+  if (!dumps.length) {
+    throw new Error('The trace has no heap dumps, is this build without the allocator shim?')
+  }
+  console.log('Symbolizing the heap dumps...')
+  const offsets = moduleOffsets(maps, regions)
+  const moduleFiles = new Map()
+  for (const pidOffsets of offsets.values()) {
+    for (const { file, offset } of pidOffsets.values()) {
+      if (!moduleFiles.has(file)) {
+        moduleFiles.set(file, new Set())
+      }
+      moduleFiles.get(file).add(offset)
+    }
+  }
+  const symbols = symbolize(moduleFiles, options.srcDir)
+  const resolveFrame = (pid, name) => {
+    const native = offsets.get(pid).get(name)
+    const symbol = native && symbols.get(`${native.file}:${native.offset}`)
+    return symbol && { function: symbol.function, source: braveSource(symbol.location, options.srcDir, options.outDir) }
+  }
+  const report = Object.assign({ binary, sampling_bytes: options.samplingBytes },
+    heapReport(dumps, stepNames, processNames, maps, resolveFrame))
+  const reportFile = path.join(options.outputDir, 'heap-report.json')
+  fs.writeJsonSync(reportFile, report, { spaces: 2 })
+
+  const megabytes = (bytes) => (bytes / (1024 * 1024)).toFixed(1)
+  for (const { step, process_types: processTypes } of report.steps) {
+    console.log(`${step}:`)
+    for (const [type, totals] of Object.entries(processTypes)) {
+      console.log(`  ${type} (${totals.processes}): ${megabytes(totals.bytes)}MB sampled, ` +
+        `${megabytes(totals.brave_bytes)}MB from brave/`)
+    }
+  }
+  const last = stepNames[stepNames.length - 1]
+  console.log(`Top allocation sites in brave/ at ${last}:`)
+  for (const site of report.sites.slice(0, printedSites)) {
+    console.log(`  ${megabytes(site.bytes[last] || 0)}MB (${site.growth_bytes >= 0 ? '+' : ''}` +
+      `${megabytes(site.growth_bytes)}MB) ${site.process_type} ${site.function} ${site.source}`)
+  }
+  console.log(`Heap report written to ${reportFile}, load trace.json in chrome://tracing for the full dumps`)
+}
+
+module.exports = heapProfile
+module.exports.parseHeapDumps = parseHeapDumps
+module.exports.moduleOffsets = moduleOffsets
+module.exports.braveSource = braveSource
+module.exports.heapReport = heapReport
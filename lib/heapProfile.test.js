@@ -0,0 +1,73 @@
+const path = require('path')
+const { parseHeapDumps, moduleOffsets, braveSource, heapReport } = require('./heapProfile')
+
+const srcDir = path.join('/', 'src')
+const outDir = path.join(srcDir, 'out', 'Release')
+
+// Two dumps of a browser process; the second only has the map entries which
+// are new since the first.
+const traceEvents = [
+  { ph: 'M', pid: 1, name: 'process_name', args: { name: 'Browser' } },
+  { ph: 'v', pid: 1, id: '0x2', ts: 20, args: { dumps: {
+    heaps_v2: {
+      maps: { strings: [{ id: 5, string: 'pc:1200' }], nodes: [{ id: 4, parent: 2, name_sid: 5 }] },
+      allocators: { malloc: { nodes: [3, 4], counts: [2, 1], sizes: [300, 50], types: [0, 0] } }
+    }
+  } } },
+  { ph: 'v', pid: 1, id: '0x1', ts: 10, args: { dumps: {
+    process_mmaps: { vm_regions: [
+      { sa: '1000', sz: '1000', mf: '/src/out/Release/brave' },
+      { sa: '2000', sz: '1000', mf: '/src/out/Release/brave' }
+    ] },
+    heaps_v2: {
+      maps: {
+        strings: [{ id: 1, string: 'pc:1100' }, { id: 2, string: 'pc:2100' }, { id: 3, string: 'pc:1400' }],
+        nodes: [{ id: 1, name_sid: 1 }, { id: 2, parent: 1, name_sid: 2 }, { id: 3, parent: 2, name_sid: 3 }]
+      },
+      allocators: { malloc: { nodes: [3], counts: [1], sizes: [100], types: [0] } }
+    }
+  } } }
+]
+
+test('parses heap dumps in the order they were taken', function () {
+  const { processNames, maps, dumps } = parseHeapDumps(traceEvents)
+  expect(processNames.get(1)).toBe('Browser')
+  expect(dumps.length).toBe(2)
+  expect(dumps[0].get(1)).toEqual([{ allocator: 'malloc', node: 3, count: 1, size: 100 }])
+  expect(dumps[1].get(1).length).toBe(2)
+  expect(maps.get(1).nodes.size).toBe(4)
+})
+
+test('maps native frames to module offsets from the load address', function () {
+  const { maps, regions } = parseHeapDumps(traceEvents)
+  const offsets = moduleOffsets(maps, regions).get(1)
+  expect(offsets.get('pc:2100').file).toBe('/src/out/Release/brave')
+  expect(offsets.get('pc:2100').offset.toString(16)).toBe('1100')
+  expect(offsets.get('pc:1200').offset.toString(16)).toBe('200')
+})
+
+test('only attributes to sources under brave/', function () {
+  expect(braveSource('../../brave/components/foo.cc:12:3', srcDir, outDir)).toBe('brave/components/foo.cc:12')
+  expect(braveSource('../../base/memory/foo.cc:12', srcDir, outDir)).toBe(null)
+  expect(braveSource('??:0', srcDir, outDir)).toBe(null)
+})
+
+test('reports the innermost brave frame of every allocation', function () {
+  const { processNames, maps, dumps } = parseHeapDumps(traceEvents)
+  const frames = {
+    'pc:1100': { function: 'main', source: null },
+    'pc:2100': { function: 'brave::Service::Load', source: 'brave/service.cc:10' },
+    'pc:1400': { function: 'malloc', source: null },
+    'pc:1200': { function: 'brave::Cache::Add', source: 'brave/cache.cc:5' }
+  }
+  const report = heapReport(dumps, ['startup', 'pages_open'], processNames, maps,
+    (pid, name) => frames[name])
+  expect(report.steps[1]).toEqual({
+    step: 'pages_open',
+    process_types: { Browser: { processes: 1, bytes: 350, brave_bytes: 350 } }
+  })
+  expect(report.sites.map((site) => [site.source, site.bytes.pages_open, site.growth_bytes])).toEqual([
+    ['brave/service.cc:10', 300, 200],
+    ['brave/cache.cc:5', 50, 50]
+  ])
+})
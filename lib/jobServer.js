@@ -0,0 +1,100 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const os = require('os')
+const fs = require('fs-extra')
+const { spawnSync } = require('child_process')
+
+// ninja reads a GNU make style jobserver from MAKEFLAGS starting with 1.13.
+const minJobServerNinjaVersion = [1, 13]
+
+const parseVersion = (version) => (version || '').trim().split('.').map((part) => parseInt(part, 10) || 0)
+
+const isVersionAtLeast = (version, minVersion) => {
+  const parts = parseVersion(version)
+  for (let i = 0; i < minVersion.length; i++) {
+    if ((parts[i] || 0) !== minVersion[i]) {
+      return (parts[i] || 0) > minVersion[i]
+    }
+  }
+  return true
+}
+
+// Splits |jobs| between |clients| concurrent processes for executors which
+// cannot take part in a jobserver. Every client gets at least one job.
+const splitJobs = (jobs, clients) => {
+  const shares = []
+  for (let i = 0; i < clients; i++) {
+    shares.push(Math.max(1, Math.floor(jobs / clients) + (i < jobs % clients ? 1 : 0)))
+  }
+  return shares
+}
+
+// A jobserver-style token budget shared by several concurrent ninja processes.
+// Every client owns one implicit token, so the pipe is primed with
+// |jobs - clients| tokens.
+module.exports = class JobServer {
+  constructor (jobs, clients, env, isNinja = true) {
+    this.jobs = jobs
+    this.clients = clients
+    this.fifoPath = null
+    this.fd = null
+    this.shares = splitJobs(jobs, clients)
+    this.supported = isNinja && process.platform !== 'win32' &&
+      isVersionAtLeast(JobServer.ninjaVersion(env), minJobServerNinjaVersion)
+  }
+
+  static ninjaVersion (env) {
+    const prog = spawnSync('ninja', ['--version'], { env, shell: true })
+    return prog.status === 0 ? prog.stdout.toString() : ''
+  }
+
+  start () {
+    if (!this.supported) {
+      return
+    }
+    this.fifoPath = path.join(os.tmpdir(), `brave-jobserver-${process.pid}`)
+    fs.removeSync(this.fifoPath)
+    const prog = spawnSync('mkfifo', [this.fifoPath])
+    if (prog.status !== 0) {
+      this.supported = false
+      return
+    }
+    // Opening read-write keeps the fifo alive while no client has it open.
+    this.fd = fs.openSync(this.fifoPath, fs.constants.O_RDWR | fs.constants.O_NONBLOCK)
+    const tokens = Math.max(this.jobs - this.clients, 0)
+    if (tokens) {
+      fs.writeSync(this.fd, Buffer.alloc(tokens, '+'))
+    }
+  }
+
+  // Returns the environment and extra ninja arguments for the |index|th
+  // client. Passing -j to ninja disables its jobserver client, so it is only
+  // used for the even split fallback.
+  clientOptions (index, env) {
+    if (this.supported) {
+      return {
+        env: Object.assign({}, env, { MAKEFLAGS: `-j${this.jobs} --jobserver-auth=fifo:${this.fifoPath}` }),
+        ninjaOpts: []
+      }
+    }
+    return { env, ninjaOpts: ['-j', this.shares[index]] }
+  }
+
+  stop () {
+    if (this.fd !== null) {
+      fs.closeSync(this.fd)
+      this.fd = null
+    }
+    if (this.fifoPath) {
+      fs.removeSync(this.fifoPath)
+      this.fifoPath = null
+    }
+  }
+}
+
+module.exports.splitJobs = splitJobs
+module.exports.isVersionAtLeast = isVersionAtLeast
@@ -0,0 +1,13 @@
+const JobServer = require('./jobServer')
+
+test('splits jobs evenly when no jobserver is available', function () {
+  expect(JobServer.splitJobs(10, 3)).toEqual([4, 3, 3])
+  expect(JobServer.splitJobs(2, 3)).toEqual([1, 1, 1])
+})
+
+test('compares ninja versions', function () {
+  expect(JobServer.isVersionAtLeast('1.13.0\n', [1, 13])).toBe(true)
+  expect(JobServer.isVersionAtLeast('1.9.0.git', [1, 13])).toBe(false)
+  expect(JobServer.isVersionAtLeast('2.0', [1, 13])).toBe(true)
+  expect(JobServer.isVersionAtLeast('', [1, 13])).toBe(false)
+})
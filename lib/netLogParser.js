@@ -0,0 +1,152 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const fs = require('fs-extra')
+
+const QUOTE = 0x22
+const BACKSLASH = 0x5c
+const OPEN_BRACE = 0x7b
+const CLOSE_BRACE = 0x7d
+const OPEN_BRACKET = 0x5b
+const CLOSE_BRACKET = 0x5d
+
+// Incremental parser for the JSON written by --log-net-log:
+//   {"constants": {...},
+//   "events": [
+//   {...},
+//   {...},
+//   ...]}
+// Only the constants and one event at a time are held in memory, each parsed
+// on its own as soon as it is complete, so the log can be of any size. A
+// browser which is killed or crashes leaves the log truncated in the middle
+// of an event, which is simply never reported.
+class NetLogParser {
+  constructor (onConstants, onEvent) {
+    this.onConstants = onConstants
+    this.onEvent = onEvent
+    this.depth = 0
+    this.inString = false
+    this.escaped = false
+    this.key = null
+    this.inEvents = false
+    // What is being captured ('key', 'constants' or 'event'), the depth it
+    // started at and the text of it seen in previous chunks.
+    this.capture = null
+    this.captureDepth = 0
+    this.pieces = []
+    this.eventCount = 0
+  }
+
+  startCapture (kind) {
+    this.capture = kind
+    this.captureDepth = this.depth
+    this.pieces = []
+  }
+
+  finishCapture (text) {
+    const kind = this.capture
+    this.capture = null
+    this.pieces = []
+    const value = JSON.parse(text)
+    if (kind === 'key') {
+      this.key = value
+    } else if (kind === 'constants') {
+      this.constants = value
+      this.onConstants(value)
+    } else {
+      this.eventCount++
+      this.onEvent(value)
+    }
+  }
+
+  write (chunk) {
+    let captureStart = this.capture ? 0 : -1
+    const captured = (end) => {
+      const text = this.pieces.length
+        ? this.pieces.join('') + chunk.substring(captureStart, end)
+        : chunk.substring(captureStart, end)
+      captureStart = -1
+      return text
+    }
+    for (let i = 0; i < chunk.length; i++) {
+      const c = chunk.charCodeAt(i)
+      if (this.inString) {
+        if (this.escaped) {
+          this.escaped = false
+        } else if (c === BACKSLASH) {
+          this.escaped = true
+        } else if (c === QUOTE) {
+          this.inString = false
+          if (this.capture === 'key') {
+            this.finishCapture(captured(i + 1))
+          }
+        }
+        continue
+      }
+      if (c === QUOTE) {
+        this.inString = true
+        if (this.depth === 1 && !this.capture) {
+          this.startCapture('key')
+          captureStart = i
+        }
+      } else if (c === OPEN_BRACE || c === OPEN_BRACKET) {
+        if (!this.capture) {
+          if (this.depth === 1 && this.key === 'constants' && c === OPEN_BRACE) {
+            this.startCapture('constants')
+            captureStart = i
+          } else if (this.depth === 2 && this.inEvents && c === OPEN_BRACE) {
+            this.startCapture('event')
+            captureStart = i
+          } else if (this.depth === 1 && this.key === 'events' && c === OPEN_BRACKET) {
+            this.inEvents = true
+          }
+        }
+        this.depth++
+      } else if (c === CLOSE_BRACE || c === CLOSE_BRACKET) {
+        this.depth--
+        if (this.capture && this.depth === this.captureDepth) {
+          this.finishCapture(captured(i + 1))
+        } else if (this.depth === 1) {
+          this.inEvents = false
+        }
+      }
+    }
+    if (this.capture) {
+      this.pieces.push(chunk.substring(captureStart))
+    }
+  }
+
+  // Whether the log ended before it was complete.
+  end () {
+    this.truncated = this.depth > 0
+    this.pieces = []
+    return this.truncated
+  }
+}
+
+// Streams |file| through a NetLogParser. Resolves to the parser once the
+// whole file was read.
+const parseFile = (file, onConstants, onEvent) => {
+  const parser = new NetLogParser(onConstants, onEvent)
+  return new Promise((resolve, reject) => {
+    const stream = fs.createReadStream(file, { encoding: 'utf8', highWaterMark: 1024 * 1024 })
+    stream.on('data', (chunk) => {
+      try {
+        parser.write(chunk)
+      } catch (e) {
+        stream.destroy()
+        reject(e)
+      }
+    })
+    stream.on('error', reject)
+    stream.on('end', () => {
+      parser.end()
+      resolve(parser)
+    })
+  })
+}
+
+module.exports = NetLogParser
+module.exports.parseFile = parseFile
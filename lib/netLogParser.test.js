@@ -0,0 +1,35 @@
+const NetLogParser = require('./netLogParser')
+
+const netLog = [
+  '{"constants":{"logSourceType":{"URL_REQUEST":1},"logEventTypes":{"URL_REQUEST_FAKE_RESPONSE_HEADERS_CREATED":2}},',
+  '"events": [',
+  '{"params":{"url":"https://a.brave.com/{\\"}]","text":"\\\\\\\\"},"source":{"type":1},"type":3},',
+  '{"params":{"url":"https://b.brave.com/"},"source":{"type":1},"type":3},',
+  ''
+].join('\n')
+
+const parse = (text, chunkSize) => {
+  const events = []
+  let constants
+  const parser = new NetLogParser((value) => { constants = value }, (event) => events.push(event))
+  for (let i = 0; i < text.length; i += chunkSize) {
+    parser.write(text.substring(i, i + chunkSize))
+  }
+  parser.end()
+  return { parser, constants, events }
+}
+
+test('parses events across chunk boundaries', function () {
+  for (const chunkSize of [1, 2, 3, 7, 1000]) {
+    const { parser, constants, events } = parse(netLog + ']}', chunkSize)
+    expect(constants.logSourceType.URL_REQUEST).toBe(1)
+    expect(events.map((event) => event.params.url)).toEqual(['https://a.brave.com/{"}]', 'https://b.brave.com/'])
+    expect(parser.truncated).toBe(false)
+  }
+})
+
+test('drops the incomplete event of a truncated log', function () {
+  const { parser, events } = parse(netLog + '{"params":{"url":"https://c.br', 5)
+  expect(events.length).toBe(2)
+  expect(parser.truncated).toBe(true)
+})
@@ -0,0 +1,198 @@
+const fs = require('fs-extra')
+const { StringDecoder } = require('string_decoder')
+const BrowserProcess = require('./browserProcess')
+const NetLogParser = require('./netLogParser')
+const UrlWhitelist = require('./urlWhitelist')
+const whitelistedUrlPrefixes = require('./whitelistedUrlPrefixes')
+const whitelistedUrlPatterns = require('./whitelistedUrlPatterns')
+const whitelistedUrlProtocols = [
+  'chrome-extension:',
+  'chrome:',
+  'brave:',
+  'file:',
+  'data:',
+  'blob:'
+]
+
+const { sleep, pollIntervalMs } = BrowserProcess
+
+// Appends JSON values to a file as one array, so the audit results do not
+// have to be kept in memory.
+class JsonArrayWriter {
+  constructor (file) {
+    this.fd = fs.openSync(file, 'w')
+    this.count = 0
+    fs.writeSync(this.fd, '[')
+  }
+
+  write (value) {
+    fs.writeSync(this.fd, (this.count++ ? ',' : '') + JSON.stringify(value))
+  }
+
+  close () {
+    fs.writeSync(this.fd, ']')
+    fs.closeSync(this.fd)
+  }
+}
+
+// Checks the URL requests of a NetLog event by event. Events worth keeping in
+// the results are passed to |onResult|. |failed| is set once a request to a
+// non whitelisted URL was seen.
+class NetworkAudit {
+  constructor (onResult, label) {
+    this.onResult = onResult
+    this.logPrefix = label ? `[${label}] ` : ''
+    this.failed = false
+    this.whitelist = new UrlWhitelist(whitelistedUrlPrefixes, whitelistedUrlPatterns, whitelistedUrlProtocols)
+  }
+
+  setConstants (constants) {
+    this.URL_REQUEST_TYPE = constants.logSourceType.URL_REQUEST
+    this.URL_REQUEST_FAKE_RESPONSE_HEADERS_CREATED = constants.logEventTypes.URL_REQUEST_FAKE_RESPONSE_HEADERS_CREATED
+  }
+
+  checkEvent (event) {
+    if (event.type === this.URL_REQUEST_FAKE_RESPONSE_HEADERS_CREATED) {
+      // showing these helps determine which URL requests which don't
+      // actually hit the network
+      this.onResult(event)
+      return
+    }
+    if (!event.source || event.source.type !== this.URL_REQUEST_TYPE || !event.params) {
+      return
+    }
+    const url = event.params.url
+    if (!url) {
+      return
+    }
+    const verdict = this.whitelist.check(url)
+    if (verdict === 'ignored') {
+      return
+    }
+    this.onResult(event)
+    if (verdict === 'private') {
+      // Warn but don't fail the audit
+      console.log(this.logPrefix + 'NETWORK AUDIT WARN:', url)
+    } else if (verdict === 'blocked') {
+      // This is not a whitelisted URL! log it and exit with non-zero
+      console.log(this.logPrefix + 'NETWORK AUDIT FAIL:', url)
+      this.failed = true
+    }
+  }
+}
+
+// Exit code of an audit once the whole log was parsed.
+const auditExitCode = (networkLogFile, parser, audit) => {
+  if (!parser.constants) {
+    console.log(`${audit.logPrefix}${networkLogFile} has no NetLog constants, it is empty or not a NetLog`)
+    return 1
+  }
+  if (parser.truncated) {
+    // e.g. on Windows the log ends abruptly when the browser is killed
+    console.log(`${audit.logPrefix}${networkLogFile} is truncated, audited its ${parser.eventCount} complete events`)
+  }
+  return audit.failed ? 1 : 0
+}
+
+// Audits |networkLogFile| while streaming it and writes the relevant events
+// to |resultsFile|. Resolves to the exit code of the audit.
+const auditNetworkLog = async (networkLogFile, resultsFile) => {
+  const results = new JsonArrayWriter(resultsFile)
+  const audit = new NetworkAudit((event) => results.write(event))
+  let parser
+  try {
+    parser = await NetLogParser.parseFile(networkLogFile,
+      (constants) => audit.setConstants(constants),
+      (event) => audit.checkEvent(event))
+  } finally {
+    results.close()
+  }
+  return auditExitCode(networkLogFile, parser, audit)
+}
+
+// Feeds what the browser appends to its NetLog into |parser|.
+class NetLogTail {
+  constructor (file, parser) {
+    this.file = file
+    this.parser = parser
+    this.fd = null
+    this.position = 0
+    this.decoder = new StringDecoder('utf8')
+    this.buffer = Buffer.alloc(1024 * 1024)
+  }
+
+  read () {
+    if (this.fd === null) {
+      if (!fs.existsSync(this.file)) {
+        return
+      }
+      this.fd = fs.openSync(this.file, 'r')
+    }
+    let bytesRead
+    while ((bytesRead = fs.readSync(this.fd, this.buffer, 0, this.buffer.length, this.position)) > 0) {
+      this.position += bytesRead
+      this.parser.write(this.decoder.write(this.buffer.slice(0, bytesRead)))
+    }
+  }
+
+  close () {
+    this.read()
+    this.parser.write(this.decoder.end())
+    this.parser.end()
+    if (this.fd !== null) {
+      fs.closeSync(this.fd)
+    }
+  }
+}
+
+// Runs |binary| with |args| (which make it log to |networkLogFile|) and
+// audits the NetLog while it is written. The browser is shut down once no
+// new URL request appeared for |options.quietPeriodMs| after
+// |options.warmupMs|, or after |options.timeoutMs| at the latest. Output is
+// prefixed with |options.label| when set. Resolves to the exit code of the
+// audit.
+const runNetworkAudit = async (binary, args, networkLogFile, resultsFile, options) => {
+  fs.removeSync(networkLogFile)
+  const results = new JsonArrayWriter(resultsFile)
+  const audit = new NetworkAudit((event) => results.write(event), options.label)
+  // Source ids only grow, so a larger one is a new request.
+  let lastSourceId = -1
+  let lastNewRequest = Date.now()
+  const parser = new NetLogParser((constants) => audit.setConstants(constants), (event) => {
+    audit.checkEvent(event)
+    if (event.source && event.source.type === audit.URL_REQUEST_TYPE && event.source.id > lastSourceId) {
+      lastSourceId = event.source.id
+      lastNewRequest = Date.now()
+    }
+  })
+  const tail = new NetLogTail(networkLogFile, parser)
+
+  const browser = new BrowserProcess(binary, args, { env: options.env, logPrefix: audit.logPrefix })
+  try {
+    while (!browser.exited) {
+      await sleep(pollIntervalMs)
+      tail.read()
+      const now = Date.now()
+      if (now - browser.startTime >= options.timeoutMs) {
+        console.log(`${audit.logPrefix}Network audit reached its ${options.timeoutMs / 1000}s limit, quitting Brave`)
+        break
+      }
+      if (now - browser.startTime >= options.warmupMs && now - lastNewRequest >= options.quietPeriodMs) {
+        console.log(`${audit.logPrefix}No new URL requests for ${options.quietPeriodMs / 1000}s, quitting Brave`)
+        break
+      }
+    }
+    await browser.stop()
+    tail.close()
+  } finally {
+    results.close()
+  }
+  console.log(`${audit.logPrefix}Network audit ran for ${Math.round((Date.now() - browser.startTime) / 1000)}s`)
+  return auditExitCode(networkLogFile, parser, audit)
+}
+
+module.exports = {
+  NetworkAudit,
+  auditNetworkLog,
+  runNetworkAudit
+}
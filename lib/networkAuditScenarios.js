@@ -0,0 +1,28 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Scenarios for `npm run network-audit -- --scenarios=<names|all>`. Each one
+// is a set of `start` options applied on top of the command line ones, and
+// |preferences| seeded into its fresh user data dir. Scenarios run
+// concurrently, each capped at the 2 minutes of the network audit, so `all`
+// fits the 4 minute audit-network stage of the Jenkinsfile.
+const rewardsPreferences = {
+  brave: {
+    rewards: { enabled: true },
+    brave_ads: { enabled: true }
+  }
+}
+
+module.exports = {
+  default: {},
+  rewards: { rewards: 'staging=true', preferences: rewardsPreferences },
+  ads_staging: { brave_ads_staging: true, preferences: rewardsPreferences },
+  extensions_disabled: {
+    disable_brave_extension: true,
+    disable_brave_rewards_extension: true,
+    disable_pdfjs_extension: true,
+    disable_webtorrent_extension: true
+  }
+}
@@ -0,0 +1,25 @@
+const path = require('path')
+const config = require('../lib/config')
+const util = require('../lib/util')
+const testBundle = require('./testBundle')
+const testShards = require('./testShards')
+
+const packageTests = (suite, buildConfig = config.defaultBuildConfig, options) => {
+  config.buildConfig = buildConfig
+  config.update(options)
+
+  if (process.platform !== 'linux' || config.targetOS) {
+    console.error('Test bundles are only supported for Linux builds')
+    process.exit(1)
+  }
+
+  util.run('ninja', ['-C', config.outputDir, suite], config.defaultOptions)
+
+  const binary = path.join(config.outputDir, suite)
+  const tests = testShards.listTests(binary, options.filter)
+  const bundleDir = testBundle.createBundle(suite, binary, tests)
+  const manifest = testBundle.readBundle(bundleDir)
+  console.log(`packaged ${manifest.tests.length} tests of ${suite} with ${manifest.files} files into ${bundleDir}`)
+}
+
+module.exports = packageTests
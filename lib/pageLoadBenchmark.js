@@ -0,0 +1,240 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const os = require('os')
+const fs = require('fs-extra')
+const URL = require('url').URL
+const BrowserProcess = require('./browserProcess')
+const DevToolsPipe = require('./devtoolsPipe')
+const ReplayServer = require('./replayServer')
+const { withBenchmarkEnvironment } = require('./startupBenchmark')
+const { writePreferences } = require('./benchmarkProfile')
+const { processTreeCpuTime } = require('./processMemory')
+const { summarize, confidenceInterval, differenceInterval } = require('./benchmarkStats')
+
+const { sleep } = BrowserProcess
+
+// Time the browser gets after launch, before the first page load.
+const startupSettleMs = 5000
+const pageTimeoutMs = 60000
+// Time a page gets after its load event to make its late requests when a
+// corpus is recorded.
+const recordSettleMs = 5000
+
+const pageLoadMetrics = ['ttfb_ms', 'first_contentful_paint_ms', 'dom_content_loaded_ms',
+  'load_ms', 'renderer_cpu_ms', 'script_ms', 'process_cpu_ms', 'requests', 'blocked_requests']
+
+// Navigation timing of the page, relative to the start of the navigation.
+const navigationTimingScript = `JSON.stringify((() => {
+  const navigation = performance.getEntriesByType('navigation')[0]
+  const paint = performance.getEntriesByName('first-contentful-paint')[0]
+  return {
+    ttfb_ms: navigation.responseStart,
+    first_contentful_paint_ms: paint ? paint.startTime : null,
+    dom_content_loaded_ms: navigation.domContentLoadedEventEnd,
+    load_ms: navigation.loadEventStart
+  }
+})())`
+
+// Profile preferences of each shields mode. Shields are up by default;
+// 'off' adds the exception the Shields panel sets when they are turned down
+// for a site, for the site of every page of the corpus.
+const shieldsModes = {
+  on: () => ({}),
+  off: (pages) => {
+    const exceptions = {}
+    for (const page of pages) {
+      exceptions[`*://${new URL(page).hostname}/*,*`] = { per_resource: { braveShields: 2 } }
+    }
+    return { profile: { content_settings: { exceptions: { plugins: exceptions } } } }
+  }
+}
+
+const metricsOf = async (devtools, sessionId) => {
+  const { metrics } = await devtools.send('Performance.getMetrics', {}, sessionId)
+  const values = {}
+  metrics.forEach((metric) => { values[metric.name] = metric.value })
+  return values
+}
+
+// Loads |url| in a new tab and returns its metrics, or null if it did not
+// load within |pageTimeoutMs|.
+const loadPage = async (devtools, browser, url, afterLoadMs) => {
+  const { targetId } = await devtools.send('Target.createTarget', { url: 'about:blank' })
+  const { sessionId } = await devtools.send('Target.attachToTarget', { targetId, flatten: true })
+  let requests = 0
+  let blockedRequests = 0
+  const onRequest = (params, eventSessionId) => {
+    if (eventSessionId === sessionId) {
+      requests++
+    }
+  }
+  const onFailed = (params, eventSessionId) => {
+    if (eventSessionId === sessionId &&
+        (params.blockedReason || params.errorText === 'net::ERR_BLOCKED_BY_CLIENT')) {
+      blockedRequests++
+    }
+  }
+  devtools.on('Network.requestWillBeSent', onRequest)
+  devtools.on('Network.loadingFailed', onFailed)
+  try {
+    for (const domain of ['Page', 'Network', 'Performance']) {
+      await devtools.send(`${domain}.enable`, {}, sessionId)
+    }
+    // Subresources shared between pages are fetched every time.
+    await devtools.send('Network.setCacheDisabled', { cacheDisabled: true }, sessionId)
+    const rendererBefore = await metricsOf(devtools, sessionId)
+    const processCpuBefore = process.platform === 'linux' ? processTreeCpuTime(browser.pid) : null
+    const loaded = devtools.waitForEvent('Page.loadEventFired', sessionId, pageTimeoutMs)
+    const navigation = await devtools.send('Page.navigate', { url }, sessionId)
+    if (navigation.errorText || !await loaded) {
+      console.log(`${url} did not load: ${navigation.errorText || `no load event after ${pageTimeoutMs / 1000}s`}`)
+      return null
+    }
+    const processCpuAfter = process.platform === 'linux' ? processTreeCpuTime(browser.pid) : null
+    const rendererAfter = await metricsOf(devtools, sessionId)
+    const timing = await devtools.send('Runtime.evaluate',
+      { expression: navigationTimingScript, returnByValue: true }, sessionId)
+    if (afterLoadMs) {
+      await sleep(afterLoadMs)
+    }
+    return Object.assign(JSON.parse(timing.result.value), {
+      renderer_cpu_ms: (rendererAfter.TaskDuration - rendererBefore.TaskDuration) * 1000,
+      script_ms: (rendererAfter.ScriptDuration - rendererBefore.ScriptDuration) * 1000,
+      process_cpu_ms: processCpuBefore === null ? null : processCpuAfter - processCpuBefore,
+      requests,
+      blocked_requests: blockedRequests
+    })
+  } finally {
+    devtools.removeListener('Network.requestWillBeSent', onRequest)
+    devtools.removeListener('Network.loadingFailed', onFailed)
+    await devtools.send('Target.closeTarget', { targetId }).catch(() => {})
+  }
+}
+
+// Launches the browser with a fresh profile, or a copy of |options.profile|,
+// with |preferences| and loads every page of |pages| once. Resolves to the
+// metrics by page URL.
+const loadPages = async (binary, args, env, pages, preferences, options) => {
+  const runDir = fs.mkdtempSync(path.join(os.tmpdir(), 'brave-page-load-'))
+  const userDataDir = path.join(runDir, 'profile')
+  if (options.profile) {
+    fs.copySync(options.profile, userDataDir)
+  }
+  writePreferences(userDataDir, preferences)
+  const browser = new BrowserProcess(binary, args.concat([
+    '--remote-debugging-pipe',
+    '--user-data-dir=' + userDataDir
+  ]), { env, stdio: DevToolsPipe.pipeStdio })
+  const devtools = new DevToolsPipe(browser)
+  const results = {}
+  try {
+    await devtools.send('Browser.getVersion')
+    await sleep(startupSettleMs)
+    for (const url of pages) {
+      results[url] = await loadPage(devtools, browser, url, options.afterLoadMs)
+    }
+  } finally {
+    await devtools.send('Browser.close', {}, undefined, 5000).catch(() => {})
+    await browser.stop()
+    fs.removeSync(runDir)
+  }
+  return results
+}
+
+// Loads every page of the corpus in |corpusDir| |runs| times with shields on
+// and off, alternating which goes first, with all requests answered by a
+// replay server. Writes the metrics of each page with their 95% confidence
+// intervals, and the cost of shields (on - off), to |options.output|.
+const pageLoadBenchmark = async (binary, args, runs, options) => {
+  const server = new ReplayServer(options.corpus)
+  const pages = server.archive.pages
+  if (!pages.length) {
+    throw new Error(`The page corpus ${options.corpus} has no pages`)
+  }
+  const samples = {}
+  for (const mode of Object.keys(shieldsModes)) {
+    samples[mode] = {}
+    pages.forEach((page) => {
+      samples[mode][page] = {}
+      pageLoadMetrics.forEach((metric) => { samples[mode][page][metric] = [] })
+    })
+  }
+
+  await server.start()
+  try {
+    await withBenchmarkEnvironment(args.concat(server.browserArgs()), async (benchArgs, env) => {
+      for (let run = 1; run <= runs; run++) {
+        const modes = Object.keys(shieldsModes)
+        for (const mode of run % 2 ? modes : modes.reverse()) {
+          const results = await loadPages(binary, benchArgs, env, pages, shieldsModes[mode](pages), options)
+          for (const [page, metrics] of Object.entries(results)) {
+            if (metrics) {
+              pageLoadMetrics.forEach((metric) => samples[mode][page][metric].push(metrics[metric]))
+            }
+          }
+          console.log(`run ${run}/${runs} shields ${mode}: loaded ${Object.values(results).filter((metrics) => metrics).length}/${pages.length} pages`)
+        }
+      }
+    })
+  } finally {
+    await server.stop()
+  }
+
+  const report = {
+    binary,
+    runs,
+    corpus: path.resolve(options.corpus),
+    replay: server.stats(),
+    pages: {}
+  }
+  for (const page of pages) {
+    const pageReport = report.pages[page] = { shields_on: {}, shields_off: {}, shields_cost: {} }
+    for (const metric of pageLoadMetrics) {
+      const on = samples.on[page][metric]
+      const off = samples.off[page][metric]
+      pageReport.shields_on[metric] = Object.assign(summarize(on), { ci95: confidenceInterval(on) })
+      pageReport.shields_off[metric] = Object.assign(summarize(off), { ci95: confidenceInterval(off) })
+      pageReport.shields_cost[metric] = differenceInterval(off, on)
+    }
+    const load = pageReport.shields_cost.load_ms
+    console.log(`${page}: load ${pageReport.shields_on.load_ms.mean}ms with shields, ` +
+      `${pageReport.shields_off.load_ms.mean}ms without (${load.mean}ms, 95% CI [${load.low}, ${load.high}]), ` +
+      `${pageReport.shields_on.blocked_requests.mean} blocked requests`)
+  }
+  if (report.replay.missed) {
+    console.log(`${report.replay.missed} requests were not in the corpus and got a 404, see replay.missedUrls in the report`)
+  }
+
+  fs.writeJsonSync(options.output, report, { spaces: 2 })
+  console.log(`page load benchmark written to ${options.output}`)
+  return report
+}
+
+// Loads every page of the corpus in |corpusDir| once with shields off, so
+// that every request a page can make is seen, and adds the responses of the
+// network to the corpus.
+const recordCorpus = async (binary, args, options) => {
+  const server = new ReplayServer(options.corpus, { record: true })
+  const pages = server.archive.pages
+  if (!pages.length) {
+    throw new Error(`List the pages to record in ${path.join(options.corpus, 'corpus.json')} first`)
+  }
+  await server.start()
+  try {
+    await withBenchmarkEnvironment(args.concat(server.browserArgs()), async (benchArgs, env) => {
+      await loadPages(binary, benchArgs, env, pages, shieldsModes.off(pages),
+        Object.assign({}, options, { afterLoadMs: recordSettleMs }))
+    })
+  } finally {
+    await server.stop()
+  }
+  console.log(`recorded ${server.stats().recorded} responses for ${pages.length} pages into ${options.corpus}`)
+}
+
+module.exports = pageLoadBenchmark
+module.exports.recordCorpus = recordCorpus
+module.exports.loadPages = loadPages
@@ -0,0 +1,228 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const os = require('os')
+const fs = require('fs-extra')
+const { spawnSync } = require('child_process')
+const config = require('../lib/config')
+const util = require('../lib/util')
+const { prepareBuild } = require('./build')
+const BrowserProcess = require('./browserProcess')
+const DevToolsPipe = require('./devtoolsPipe')
+const { withBenchmarkEnvironment } = require('./startupBenchmark')
+const { writePreferences, withReplayServer, openTab, lbrSupported } = require('./benchmarkProfile')
+
+const { sleep } = BrowserProcess
+
+// The training workload. It is fixed so that profiles of different builds
+// are comparable.
+const startupRuns = 3
+const startupSettleMs = 5000
+const tabDwellMs = 3000
+const maxPages = 20
+// WebUI pages, which also wake up the Rewards extension.
+const webUIPages = ['chrome://newtab/', 'chrome://rewards/', 'chrome://settings/']
+const shutdownTimeoutMs = 30000
+// Profiles older than this are trained again even if the versions match,
+// since the code under them keeps changing.
+const maxProfileAgeDays = 30
+const dayMs = 24 * 60 * 60 * 1000
+
+// Profiles are trained per Chromium build and Brave minor version, so that
+// patch-level bumps of either reuse them.
+const profileKey = (chromeVersion, braveVersion) =>
+  chromeVersion.split('.').slice(0, 3).join('.') + '-' + braveVersion.split('+')[0].split('.').slice(0, 2).join('.')
+
+// Whether the profile described by |metadata| can be used for a build of
+// |key| at |nowMs|, and why not.
+const profileFreshness = (metadata, key, nowMs) => {
+  if (!metadata) {
+    return { fresh: false, reason: 'there is no profile yet' }
+  }
+  if (metadata.key !== key) {
+    return { fresh: false, reason: `the profile was trained on ${metadata.key}, this is ${key}` }
+  }
+  const ageDays = (nowMs - Date.parse(metadata.created)) / dayMs
+  if (ageDays > maxProfileAgeDays) {
+    return { fresh: false, reason: `the profile is ${Math.floor(ageDays)} days old` }
+  }
+  return { fresh: true, reason: `the profile of ${metadata.brave_version} on ${metadata.chrome_version} is current` }
+}
+
+const profilePaths = (key) => {
+  const base = path.join(config.pgoDir, `brave-${key}-${config.targetArch}`)
+  return { data: base + '.afdo', metadata: base + '.json' }
+}
+
+const createLlvmProf = () => config.autofdoDir ? path.join(config.autofdoDir, 'create_llvm_prof') : 'create_llvm_prof'
+
+const llvmProfdata = () =>
+  path.join(config.srcDir, 'third_party', 'llvm-build', 'Release+Asserts', 'bin', 'llvm-profdata')
+
+// Throws unless perf can record the branch stacks AutoFDO needs and the
+// tools which turn them into a clang sample profile are there.
+const checkTools = () => {
+  if (!lbrSupported()) {
+    throw new Error('perf cannot record last branch records on this machine, which sample profiles need')
+  }
+  if (spawnSync(createLlvmProf(), ['--help']).error) {
+    throw new Error(`${createLlvmProf()} of AutoFDO (https://github.com/google/autofdo) is missing, ` +
+      'install it or point the autofdo_dir npm config at it')
+  }
+  if (!fs.existsSync(llvmProfdata())) {
+    throw new Error(`${llvmProfdata()} is missing, get it with ` +
+      '`python tools/clang/scripts/update.py --package=coverage_tools` in src')
+  }
+}
+
+// Quits the browser through DevTools so perf records a complete session.
+const quit = async (devtools, browser) => {
+  await devtools.send('Browser.close', {}, undefined, 5000).catch(() => {})
+  if (!await browser.waitForExit(shutdownTimeoutMs)) {
+    console.log('The browser did not quit, its profile will be incomplete')
+  }
+  await browser.stop()
+}
+
+// Runs the training workload on |binary| under perf, which writes a
+// profile with last branch records of every launch to |perfDir|: a few
+// startups, then loading the pages of |corpusDir| from a local replay server
+// and the WebUI pages, with Brave Rewards on so its extension runs along.
+const train = async (binary, perfDir, corpusDir) => {
+  const runDir = fs.mkdtempSync(path.join(os.tmpdir(), 'brave-pgo-'))
+  const userDataDir = path.join(runDir, 'profile')
+  writePreferences(userDataDir, { brave: { rewards: { enabled: true } } })
+  try {
+    await withReplayServer(corpusDir, async (server) => {
+      const pages = server.archive.pages.slice(0, maxPages)
+      const args = server.browserArgs().concat(['--remote-debugging-pipe', '--user-data-dir=' + userDataDir])
+      await withBenchmarkEnvironment(args, async (benchArgs, env) => {
+        let launches = 0
+        // perf follows the child processes and keeps the DevTools pipe open
+        // for the browser.
+        const launch = async () => {
+          const perfData = path.join(perfDir, `perf-${++launches}.data`)
+          const browser = new BrowserProcess('perf',
+            ['record', '-b', '-e', 'cycles:u', '-o', perfData, '--', binary, ...benchArgs],
+            { env, stdio: DevToolsPipe.pipeStdio })
+          const devtools = new DevToolsPipe(browser)
+          await devtools.send('Browser.getVersion')
+          return { browser, devtools }
+        }
+        for (let run = 1; run <= startupRuns; run++) {
+          console.log(`Training startup ${run}/${startupRuns}...`)
+          const { browser, devtools } = await launch()
+          await sleep(startupSettleMs)
+          await quit(devtools, browser)
+        }
+
+        console.log(`Training with ${pages.length} pages and ${webUIPages.length} WebUI pages...`)
+        const { browser, devtools } = await launch()
+        try {
+          await sleep(startupSettleMs)
+          for (const url of pages.concat(webUIPages)) {
+            const tab = await openTab(devtools, url)
+            if (!tab.loaded) {
+              console.log(`${url} did not load`)
+            }
+            await sleep(tabDwellMs)
+            await devtools.send('Target.closeTarget', { targetId: tab.targetId })
+          }
+        } finally {
+          await quit(devtools, browser)
+        }
+      })
+    })
+  } finally {
+    fs.removeSync(runDir)
+  }
+}
+
+// Turns the perf profiles of |perfDir| of |binary| into one clang sample
+// profile at |output|: create_llvm_prof converts each of them and the
+// llvm-profdata of the Chromium toolchain merges them.
+const convertProfiles = (binary, perfDir, output) => {
+  const perfProfiles = fs.readdirSync(perfDir).filter((file) => file.endsWith('.data'))
+  if (!perfProfiles.length) {
+    throw new Error('perf recorded no profiles of the training workload')
+  }
+  console.log(`Converting ${perfProfiles.length} perf profiles...`)
+  const sampleProfiles = perfProfiles.map((file) => {
+    const sampleProfile = path.join(perfDir, file.replace(/\.data$/, '.afdo'))
+    util.run(createLlvmProf(), ['--binary=' + binary, '--profile=' + path.join(perfDir, file),
+      '--out=' + sampleProfile], config.defaultOptions)
+    return sampleProfile
+  })
+  fs.ensureDirSync(path.dirname(output))
+  util.run(llvmProfdata(), ['merge', '-sample', '-o', output, ...sampleProfiles], config.defaultOptions)
+}
+
+// Sample-based PGO (AutoFDO): builds brave with line tables, profiles it on
+// the training workload with perf, turns the profiles into a clang sample
+// profile and builds the release target with it through
+// clang_sample_profile_path. A current profile of a previous run is reused
+// instead of training again, unless |options.force_training|.
+const pgo = async (buildConfig = 'Release', options) => {
+  config.buildConfig = buildConfig
+  config.update(options)
+
+  if (process.platform !== 'linux') {
+    throw new Error('Profile-guided optimization is only supported for Linux builds')
+  }
+  if (!config.pgoSupported()) {
+    throw new Error('This Chromium does not build with clang_sample_profile_path, a profile would have no effect')
+  }
+
+  const outputDir = config.outputDir
+  const key = profileKey(config.chromeVersion, config.braveVersion)
+  const profile = profilePaths(key)
+  const metadata = fs.existsSync(profile.data) && fs.existsSync(profile.metadata)
+    ? fs.readJsonSync(profile.metadata)
+    : null
+  const freshness = profileFreshness(metadata, key, Date.now())
+  if (options.force_training || !freshness.fresh) {
+    console.log(options.force_training ? 'Training a new profile' : `Training a new profile, ${freshness.reason}`)
+    checkTools()
+    // create_llvm_prof maps the samples to source lines through the line
+    // tables of the profiled binary.
+    const extraGnArgs = config.extraGnArgs
+    config.extraGnArgs = Object.assign({ symbol_level: 1 }, extraGnArgs)
+    config.outputDir = `${outputDir}_pgo_training`
+    prepareBuild()
+    util.buildTarget()
+    config.extraGnArgs = extraGnArgs
+
+    const binary = path.join(config.outputDir, 'brave')
+    const perfDir = path.join(config.outputDir, 'pgo_perf_profiles')
+    fs.emptyDirSync(perfDir)
+    await train(binary, perfDir, options.page_corpus)
+    convertProfiles(binary, perfDir, profile.data)
+    fs.writeJsonSync(profile.metadata, {
+      key,
+      chrome_version: config.chromeVersion,
+      brave_version: config.braveVersion,
+      target_arch: config.targetArch,
+      created: new Date().toISOString(),
+      training: { startup_runs: startupRuns, page_corpus: options.page_corpus || 'synthetic', webui_pages: webUIPages }
+    }, { spaces: 2 })
+  } else {
+    console.log(`Reusing ${profile.data}, ${freshness.reason}`)
+  }
+
+  config.outputDir = outputDir
+  config.sampleProfilePath = profile.data
+  prepareBuild()
+  util.buildTarget()
+  console.log(`${path.join(outputDir, 'brave')} is optimized with ${profile.data}, ` +
+    `build with --pgo_profile=${profile.data} to apply it again`)
+}
+
+module.exports = (buildConfig, options) => pgo(buildConfig, options).catch((e) => {
+  console.error(e.message)
+  process.exit(1)
+})
+module.exports.profileKey = profileKey
+module.exports.profileFreshness = profileFreshness
@@ -0,0 +1,18 @@
+const { profileKey, profileFreshness } = require('./pgo')
+
+const dayMs = 24 * 60 * 60 * 1000
+const now = Date.parse('2019-10-01T00:00:00Z')
+
+test('patch-level bumps keep the profile key', function () {
+  expect(profileKey('77.0.3865.90', '0.72.74')).toBe('77.0.3865-0.72')
+  expect(profileKey('77.0.3865.120', '0.72.80+77.0.3865.120')).toBe('77.0.3865-0.72')
+  expect(profileKey('78.0.3904.70', '0.72.74')).toBe('78.0.3904-0.72')
+})
+
+test('profiles of another version or too old are stale', function () {
+  const metadata = { key: '77.0.3865-0.72', created: new Date(now - dayMs).toISOString() }
+  expect(profileFreshness(null, '77.0.3865-0.72', now).fresh).toBe(false)
+  expect(profileFreshness(metadata, '77.0.3865-0.72', now).fresh).toBe(true)
+  expect(profileFreshness(metadata, '77.0.3865-0.73', now).fresh).toBe(false)
+  expect(profileFreshness(metadata, '77.0.3865-0.72', now + 40 * dayMs).reason).toBe('the profile is 41 days old')
+})
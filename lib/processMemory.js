@@ -0,0 +1,142 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const fs = require('fs-extra')
+const { spawnSync } = require('child_process')
+
+// Memory and CPU time of a browser process tree, read from /proc.
+
+const readProcFile = (pid, file) => {
+  try {
+    return fs.readFileSync(path.join('/proc', String(pid), file), 'utf8')
+  } catch (e) {
+    // The process exited meanwhile.
+    return null
+  }
+}
+
+// Fields of /proc/<pid>/stat after the command name, from the state on.
+const statFields = (stat) => {
+  // The command name in parentheses may contain spaces.
+  return stat.substring(stat.lastIndexOf(')') + 2).split(' ')
+}
+
+const parentPid = (stat) => parseInt(statFields(stat)[1], 10)
+
+// |rootPid| and all of its descendants.
+const processTree = (rootPid) => {
+  const children = new Map()
+  for (const entry of fs.readdirSync('/proc')) {
+    if (!/^\d+$/.test(entry)) {
+      continue
+    }
+    const stat = readProcFile(entry, 'stat')
+    if (!stat) {
+      continue
+    }
+    const ppid = parentPid(stat)
+    children.set(ppid, (children.get(ppid) || []).concat(parseInt(entry, 10)))
+  }
+  const tree = []
+  const pending = [rootPid]
+  while (pending.length) {
+    const pid = pending.pop()
+    tree.push(pid)
+    pending.push(...(children.get(pid) || []))
+  }
+  return tree
+}
+
+// Chromium process type from the command line, with extension renderers and
+// the zygote helpers told apart.
+const processType = (cmdline) => {
+  const args = cmdline.split('\0')
+  const typeArg = args.find((arg) => arg.startsWith('--type='))
+  if (!typeArg) {
+    return 'browser'
+  }
+  const type = typeArg.substring('--type='.length)
+  if (type === 'renderer' && args.includes('--extension-process')) {
+    return 'extension'
+  }
+  return type
+}
+
+// Resident and private (clean + dirty) memory of |pid| in MB.
+const processMemory = (pid) => {
+  const status = readProcFile(pid, 'status')
+  const smaps = readProcFile(pid, 'smaps_rollup')
+  if (!status) {
+    return null
+  }
+  const kb = (text, field) => {
+    const match = text && new RegExp(`^${field}:\\s+(\\d+) kB`, 'm').exec(text)
+    return match ? parseInt(match[1], 10) : 0
+  }
+  return {
+    rss: kb(status, 'VmRSS') / 1024,
+    private: (kb(smaps, 'Private_Clean') + kb(smaps, 'Private_Dirty')) / 1024
+  }
+}
+
+// Number of open file descriptors of |pid|, or null if it exited.
+const processHandleCount = (pid) => {
+  try {
+    return fs.readdirSync(path.join('/proc', String(pid), 'fd')).length
+  } catch (e) {
+    return null
+  }
+}
+
+// Sums the memory and open file descriptors of the process tree of
+// |rootPid| by process type:
+// { browser: { count, rss, private, handles }, renderer: {...}, ... }
+const sampleMemory = (rootPid) => {
+  const byType = {}
+  for (const pid of processTree(rootPid)) {
+    const cmdline = readProcFile(pid, 'cmdline')
+    const memory = processMemory(pid)
+    if (!cmdline || !memory) {
+      continue
+    }
+    const type = processType(cmdline)
+    const total = byType[type] || (byType[type] = { count: 0, rss: 0, private: 0, handles: 0 })
+    total.count++
+    total.rss += memory.rss
+    total.private += memory.private
+    total.handles += processHandleCount(pid) || 0
+  }
+  return byType
+}
+
+let clockTicksPerSecond = null
+
+// User and system CPU time of the process tree of |rootPid| in ms. Processes
+// which already exited are not counted.
+const processTreeCpuTime = (rootPid) => {
+  if (clockTicksPerSecond === null) {
+    const getconf = spawnSync('getconf', ['CLK_TCK'], { encoding: 'utf8' })
+    clockTicksPerSecond = parseInt(getconf.stdout, 10) || 100
+  }
+  let ticks = 0
+  for (const pid of processTree(rootPid)) {
+    const stat = readProcFile(pid, 'stat')
+    if (stat) {
+      const fields = statFields(stat)
+      ticks += parseInt(fields[11], 10) + parseInt(fields[12], 10)
+    }
+  }
+  return ticks * 1000 / clockTicksPerSecond
+}
+
+module.exports = {
+  processTree,
+  processTreeCpuTime,
+  processType,
+  processMemory,
+  processHandleCount,
+  sampleMemory
+}
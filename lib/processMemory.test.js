@@ -0,0 +1,10 @@
+const processMemory = require('./processMemory')
+
+test('tells process types apart by their command line', function () {
+  const cmdline = (...args) => ['/opt/brave/brave', ...args].join('\0') + '\0'
+  expect(processMemory.processType(cmdline('--enable-logging'))).toBe('browser')
+  expect(processMemory.processType(cmdline('--type=renderer', '--renderer-client-id=5'))).toBe('renderer')
+  expect(processMemory.processType(cmdline('--type=renderer', '--extension-process', '--renderer-client-id=6'))).toBe('extension')
+  expect(processMemory.processType(cmdline('--type=gpu-process'))).toBe('gpu-process')
+  expect(processMemory.processType(cmdline('--type=utility', '--extension-process'))).toBe('utility')
+})
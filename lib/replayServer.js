@@ -0,0 +1,243 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const os = require('os')
+const crypto = require('crypto')
+const http = require('http')
+const https = require('https')
+const fs = require('fs-extra')
+const { spawnSync } = require('child_process')
+
+// A page corpus is a directory with a corpus.json:
+//   { "pages": ["https://example.com/", ...],
+//     "responses": [{ "method": "GET", "url": "https://example.com/",
+//                     "status": 200, "headers": {...},
+//                     "body": "bodies/<sha256>" }, ...] }
+// Bodies are stored decoded, one file per distinct content.
+const corpusFileName = 'corpus.json'
+
+// Headers which no longer describe a replayed response, or which would make
+// the browser go around the replay proxy.
+const droppedHeaders = ['content-length', 'content-encoding', 'transfer-encoding',
+  'connection', 'keep-alive', 'alt-svc', 'strict-transport-security']
+// Request headers which would get a recorded response which is not complete.
+const droppedRequestHeaders = ['proxy-connection', 'accept-encoding', 'if-none-match',
+  'if-modified-since', 'range']
+const maxMissedUrls = 100
+
+const withoutQuery = (url) => url.split('#')[0].split('?')[0]
+
+// The responses of a page corpus, looked up by method and URL, or by method
+// and URL without the query string when nothing was recorded for the exact
+// URL (e.g. cache busting parameters).
+class ReplayArchive {
+  constructor (dir) {
+    this.dir = dir
+    const file = path.join(dir, corpusFileName)
+    if (!fs.existsSync(file)) {
+      throw new Error(`${file} does not exist, see lib/replayServer.js for its format`)
+    }
+    const corpus = fs.readJsonSync(file)
+    this.pages = corpus.pages || []
+    this.responses = corpus.responses || []
+    this.exact = new Map()
+    this.fuzzy = new Map()
+    this.responses.forEach((response) => this.index(response))
+  }
+
+  index (response) {
+    const exactKey = `${response.method} ${response.url}`
+    const fuzzyKey = `${response.method} ${withoutQuery(response.url)}`
+    if (!this.exact.has(exactKey)) {
+      this.exact.set(exactKey, response)
+    }
+    if (!this.fuzzy.has(fuzzyKey)) {
+      this.fuzzy.set(fuzzyKey, response)
+    }
+  }
+
+  lookup (method, url) {
+    return this.exact.get(`${method} ${url}`) || this.fuzzy.get(`${method} ${withoutQuery(url)}`) || null
+  }
+
+  readBody (response) {
+    return response.body ? fs.readFileSync(path.join(this.dir, response.body)) : Buffer.alloc(0)
+  }
+
+  add (method, url, status, headers, body) {
+    const bodyFile = path.join('bodies', crypto.createHash('sha256').update(body).digest('hex'))
+    fs.outputFileSync(path.join(this.dir, bodyFile), body)
+    const response = { method, url, status, headers, body: bodyFile }
+    this.responses.push(response)
+    this.index(response)
+    return response
+  }
+
+  save () {
+    fs.writeJsonSync(path.join(this.dir, corpusFileName),
+      { pages: this.pages, responses: this.responses }, { spaces: 2 })
+  }
+}
+
+// Self-signed certificate for the HTTPS side of the proxy; the browser is
+// told to ignore certificate errors.
+const createCertificate = () => {
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'brave-replay-'))
+  const keyFile = path.join(dir, 'key.pem')
+  const certFile = path.join(dir, 'cert.pem')
+  const openssl = spawnSync('openssl', ['req', '-x509', '-newkey', 'rsa:2048', '-nodes',
+    '-keyout', keyFile, '-out', certFile, '-days', '1', '-subj', '/CN=brave-replay'])
+  try {
+    if (openssl.error || openssl.status !== 0) {
+      throw new Error('Could not create a certificate for the replay server with openssl: ' +
+        (openssl.error ? openssl.error.message : openssl.stderr.toString()))
+    }
+    return { key: fs.readFileSync(keyFile), cert: fs.readFileSync(certFile) }
+  } finally {
+    fs.removeSync(dir)
+  }
+}
+
+const readRequestBody = (req) => new Promise((resolve, reject) => {
+  const chunks = []
+  req.on('data', (chunk) => chunks.push(chunk))
+  req.on('end', () => resolve(Buffer.concat(chunks)))
+  req.on('error', reject)
+})
+
+const fetchUpstream = (method, url, headers, body) => new Promise((resolve, reject) => {
+  const upstreamHeaders = Object.assign({}, headers)
+  droppedRequestHeaders.forEach((header) => delete upstreamHeaders[header])
+  upstreamHeaders['accept-encoding'] = 'identity'
+  const client = url.startsWith('https:') ? https : http
+  const req = client.request(url, { method, headers: upstreamHeaders }, (res) => {
+    readRequestBody(res).then((responseBody) =>
+      resolve({ status: res.statusCode, headers: res.headers, body: responseBody }), reject)
+  })
+  req.on('error', reject)
+  req.end(body)
+})
+
+// HTTP proxy which answers every request of the browser from a page corpus,
+// so page loads never reach the network. HTTPS requests are tunneled with
+// CONNECT to an in-process TLS server. Requests which are not in the corpus
+// get a 404, unless |options.record| is set, in which case they are fetched
+// from the network and added to the corpus. |options.standIns| answer
+// requests of services outside the corpus, e.g. Brave Rewards servers:
+// [{ method, prefix, status, body }], matched by method and URL prefix, with
+// |body| sent as JSON.
+class ReplayServer {
+  constructor (corpusDir, options = {}) {
+    this.archive = new ReplayArchive(corpusDir)
+    this.record = !!options.record
+    this.standIns = options.standIns || []
+    this.served = 0
+    this.stoodIn = 0
+    this.recorded = 0
+    this.missed = 0
+    this.missedUrls = []
+    this.sockets = new Set()
+    this.proxy = http.createServer((req, res) => this.handle(req, res, req.url))
+    this.proxy.on('connection', (socket) => {
+      this.sockets.add(socket)
+      socket.on('close', () => this.sockets.delete(socket))
+    })
+    this.tls = https.createServer(createCertificate(),
+      (req, res) => this.handle(req, res, `https://${req.headers.host}${req.url}`))
+    this.proxy.on('connect', (req, socket, head) => {
+      socket.on('error', () => {})
+      socket.write('HTTP/1.1 200 Connection Established\r\n\r\n')
+      if (head && head.length) {
+        socket.unshift(head)
+      }
+      this.tls.emit('connection', socket)
+    })
+  }
+
+  start () {
+    return new Promise((resolve, reject) => {
+      this.proxy.once('error', reject)
+      this.proxy.listen(0, '127.0.0.1', () => {
+        this.port = this.proxy.address().port
+        resolve(this.port)
+      })
+    })
+  }
+
+  // Arguments which send all of the browser's traffic to the proxy, and
+  // make host names fail to resolve should anything bypass it.
+  browserArgs () {
+    return [
+      `--proxy-server=http://127.0.0.1:${this.port}`,
+      '--proxy-bypass-list=<-loopback>',
+      '--ignore-certificate-errors',
+      '--host-resolver-rules=MAP * ~NOTFOUND , EXCLUDE 127.0.0.1'
+    ]
+  }
+
+  async handle (req, res, url) {
+    try {
+      let response = this.archive.lookup(req.method, url)
+      let body = response && this.archive.readBody(response)
+      if (!response && this.record) {
+        const upstream = await fetchUpstream(req.method, url, req.headers, await readRequestBody(req))
+        response = this.archive.add(req.method, url, upstream.status, upstream.headers, upstream.body)
+        body = upstream.body
+        this.recorded++
+      }
+      const standIn = !response && this.standIns.find((standIn) =>
+        standIn.method === req.method && url.startsWith(standIn.prefix))
+      if (standIn) {
+        const standInBody = Buffer.from(JSON.stringify(standIn.body))
+        res.writeHead(standIn.status, { 'content-type': 'application/json', 'content-length': standInBody.length })
+        res.end(standInBody)
+        this.stoodIn++
+        return
+      }
+      if (!response) {
+        this.missed++
+        if (this.missedUrls.length < maxMissedUrls) {
+          this.missedUrls.push(`${req.method} ${url}`)
+        }
+        res.writeHead(404)
+        res.end()
+        return
+      }
+      const headers = Object.assign({}, response.headers)
+      droppedHeaders.forEach((header) => delete headers[header])
+      headers['content-length'] = body.length
+      res.writeHead(response.status, headers)
+      res.end(body)
+      this.served++
+    } catch (e) {
+      res.writeHead(502)
+      res.end()
+    }
+  }
+
+  stats () {
+    return {
+      served: this.served,
+      recorded: this.recorded,
+      stoodIn: this.stoodIn,
+      missed: this.missed,
+      missedUrls: this.missedUrls
+    }
+  }
+
+  stop () {
+    if (this.record) {
+      this.archive.save()
+    }
+    this.tls.close()
+    // Tunnels and kept alive connections would keep the server open.
+    this.sockets.forEach((socket) => socket.destroy())
+    return new Promise((resolve) => this.proxy.close(() => resolve()))
+  }
+}
+
+module.exports = ReplayServer
+module.exports.ReplayArchive = ReplayArchive
@@ -0,0 +1,77 @@
+const path = require('path')
+const os = require('os')
+const http = require('http')
+const fs = require('fs-extra')
+const ReplayServer = require('./replayServer')
+
+let corpusDir
+
+beforeEach(function () {
+  corpusDir = fs.mkdtempSync(path.join(os.tmpdir(), 'replay-test-'))
+  fs.outputFileSync(path.join(corpusDir, 'bodies', 'page'), '<p>hello</p>')
+  fs.writeJsonSync(path.join(corpusDir, 'corpus.json'), {
+    pages: ['http://example.com/'],
+    responses: [{
+      method: 'GET',
+      url: 'http://example.com/',
+      status: 200,
+      headers: { 'content-type': 'text/html', 'content-encoding': 'gzip' },
+      body: 'bodies/page'
+    }]
+  })
+})
+
+afterEach(function () {
+  fs.removeSync(corpusDir)
+})
+
+const get = (port, url) => new Promise((resolve, reject) => {
+  http.get({ host: '127.0.0.1', port, path: url }, (res) => {
+    let body = ''
+    res.on('data', (chunk) => { body += chunk })
+    res.on('end', () => resolve({ status: res.statusCode, headers: res.headers, body }))
+  }).on('error', reject)
+})
+
+test('looks up responses by URL, then by URL without its query', function () {
+  const archive = new ReplayServer.ReplayArchive(corpusDir)
+  expect(archive.pages).toEqual(['http://example.com/'])
+  expect(archive.lookup('GET', 'http://example.com/').status).toBe(200)
+  expect(archive.lookup('GET', 'http://example.com/?cachebust=1').status).toBe(200)
+  expect(archive.lookup('POST', 'http://example.com/')).toBe(null)
+  expect(archive.lookup('GET', 'http://example.com/other')).toBe(null)
+})
+
+test('serves the corpus as a proxy and 404s everything else', async function () {
+  const server = new ReplayServer(corpusDir)
+  const port = await server.start()
+  try {
+    const page = await get(port, 'http://example.com/')
+    expect(page.status).toBe(200)
+    expect(page.body).toBe('<p>hello</p>')
+    expect(page.headers['content-encoding']).toBe(undefined)
+    expect((await get(port, 'http://example.com/missing.js')).status).toBe(404)
+    expect(server.stats()).toEqual({
+      served: 1, recorded: 0, stoodIn: 0, missed: 1, missedUrls: ['GET http://example.com/missing.js']
+    })
+  } finally {
+    await server.stop()
+  }
+})
+
+test('answers requests outside the corpus from stand-ins', async function () {
+  const server = new ReplayServer(corpusDir, {
+    standIns: [{ method: 'GET', prefix: 'http://ledger.test/v2/wallet/', status: 200, body: { balance: '0' } }]
+  })
+  const port = await server.start()
+  try {
+    const wallet = await get(port, 'http://ledger.test/v2/wallet/1234/balance')
+    expect(wallet.status).toBe(200)
+    expect(JSON.parse(wallet.body)).toEqual({ balance: '0' })
+    expect((await get(port, 'http://ledger.test/v2/other')).status).toBe(404)
+    expect((await get(port, 'http://example.com/')).body).toBe('<p>hello</p>')
+    expect(server.stats().stoodIn).toBe(1)
+  } finally {
+    await server.stop()
+  }
+})
@@ -0,0 +1,107 @@
+const path = require('path')
+const fs = require('fs-extra')
+const config = require('../lib/config')
+const gtestResults = require('./gtestResults')
+const TestTimings = require('./testTimings')
+const testBundle = require('./testBundle')
+const { runShard } = require('./testShards')
+
+// A worker runs one shard of the bundle. Bundles are synced to ssh hosts
+// with rsync, which only transfers objects the host does not have yet, while
+// containers mount the local bundles dir.
+const sshWorker = (host, remoteDir) => ({
+  name: host,
+  run: async (bundleDir, shard, args, env) => {
+    const bundleName = path.basename(bundleDir)
+    const bundlesDir = path.dirname(bundleDir)
+    const remoteBundleDir = `${remoteDir}/${bundleName}`
+    const steps = [
+      ['ssh', [host, 'mkdir', '-p', remoteBundleDir]],
+      ['rsync', ['-a', path.join(bundlesDir, 'objects') + '/', `${host}:${remoteDir}/objects/`]],
+      ['rsync', ['-a', '--exclude=results', '--exclude=work', bundleDir + '/', `${host}:${remoteBundleDir}/`]]
+    ]
+    for (const [cmd, cmdArgs] of steps) {
+      if (await runShard(cmd, cmdArgs, env) !== 0) {
+        return 1
+      }
+    }
+    const status = await runShard('ssh', [host, 'sh', `${remoteBundleDir}/run_shard.sh`, String(shard), ...args], env)
+    fs.ensureDirSync(path.join(bundleDir, 'results'))
+    await runShard('rsync', [`${host}:${remoteBundleDir}/results/${shard}.xml`, path.join(bundleDir, 'results', `${shard}.xml`)], env)
+    return status
+  }
+})
+
+const containerWorker = (index, image) => ({
+  name: `container ${index}`,
+  run: (bundleDir, shard, args, env) => {
+    const bundlesDir = path.dirname(bundleDir)
+    const mountedBundleDir = `/bundles/${path.basename(bundleDir)}`
+    return runShard('docker', [
+      'run', '--rm', '--shm-size=2g',
+      '-v', `${bundlesDir}:/bundles`,
+      image,
+      'sh', `${mountedBundleDir}/run_shard.sh`, String(shard), ...args
+    ], env)
+  }
+})
+
+const getWorkers = (options) => {
+  if (options.hosts) {
+    return options.hosts.split(',').filter((host) => host).map((host) => sshWorker(host, options.remote_dir))
+  }
+  if (options.containers) {
+    if (!options.image) {
+      console.error('--containers needs an --image with the runtime libraries of the tests')
+      process.exit(1)
+    }
+    const count = parseInt(options.containers, 10)
+    return Array.from({ length: count }, (value, index) => containerWorker(index, options.image))
+  }
+  console.error('Pass --hosts or --containers to choose where the bundle runs')
+  process.exit(1)
+}
+
+// Runs the shards of a bundle made by `package_tests` on other hosts or in
+// containers, one shard per worker, and merges their results.
+const runTestBundle = async (bundleDir, options) => {
+  bundleDir = path.resolve(bundleDir)
+  const bundle = testBundle.readBundle(bundleDir)
+  const workers = getWorkers(options)
+  const timings = new TestTimings(config.testHistoryDir, bundle.suite)
+  const shards = timings.shards(bundle.tests, workers.length)
+
+  fs.removeSync(path.join(bundleDir, 'results'))
+  fs.ensureDirSync(path.join(bundleDir, 'shards'))
+  shards.forEach((shard, index) =>
+    fs.writeFileSync(path.join(bundleDir, 'shards', `${index}.filter`), shard.tests.join('\n') + '\n'))
+
+  const args = ['--enable-logging', '--v=' + options.v]
+  const statuses = await Promise.all(workers.map((worker, index) => {
+    const shard = shards[index]
+    console.log(`${bundle.suite} shard ${index + 1}/${shards.length} on ${worker.name}: ${shard.tests.length} tests, ~${Math.round(shard.total)}s`)
+    if (!shard.tests.length) {
+      // An empty filter file would run the whole suite.
+      return 0
+    }
+    return worker.run(bundleDir, index, args, config.defaultOptions.env)
+  }))
+
+  const output = path.resolve(options.output || `${bundle.suite}.xml`)
+  const shardOutputs = shards.map((shard, index) => path.join(bundleDir, 'results', `${index}.xml`))
+    .filter((file, index) => shards[index].tests.length)
+  const tests = gtestResults.merge(shardOutputs, output)
+  timings.recordResults(output)
+  console.log(`${tests.length} results of ${bundle.suite} written to ${output}`)
+
+  const reported = new Set(tests.map(gtestResults.fullName))
+  const missing = bundle.tests.filter((test) => !reported.has(test)).length
+  if (missing > 0) {
+    console.error(`${missing} tests of ${bundle.suite} did not report results`)
+  }
+  if (missing > 0 || statuses.some((status) => status !== 0)) {
+    process.exit(1)
+  }
+}
+
+module.exports = runTestBundle
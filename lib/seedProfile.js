@@ -0,0 +1,273 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const fs = require('fs-extra')
+const { spawnSync } = require('child_process')
+const config = require('../lib/config')
+const start = require('./start')
+const BrowserProcess = require('./browserProcess')
+const { withBenchmarkEnvironment } = require('./startupBenchmark')
+const { writePreferences } = require('./benchmarkProfile')
+
+// How much data each size of profile has. Rewards publishers are picked
+// from the most visited domains.
+const presets = {
+  small: { domains: 200, history: 5000, bookmarks: 500, publishers: 100 },
+  medium: { domains: 1000, history: 50000, bookmarks: 5000, publishers: 1000 },
+  large: { domains: 4000, history: 200000, bookmarks: 20000, publishers: 3000 }
+}
+
+const profileCreationTimeoutMs = 60000
+// Time the browser gets to finish creating its databases once History exists.
+const profileSettleMs = 5000
+// Chromium expires history older than 90 days at startup.
+const historyDays = 85
+const dayMs = 24 * 60 * 60 * 1000
+// Length of a Brave Rewards reconcile period.
+const reconcilePeriodDays = 30
+const rowsPerInsert = 500
+// PAGE_TRANSITION_LINK and PAGE_TRANSITION_TYPED, with CHAIN_START and
+// CHAIN_END.
+const linkTransition = 0x30000000
+const typedTransition = 0x30000001
+
+const words = ['news', 'shop', 'blog', 'video', 'music', 'travel', 'recipes', 'sports',
+  'weather', 'code', 'docs', 'forum', 'photos', 'games', 'finance', 'health', 'maps',
+  'mail', 'search', 'wiki', 'learn', 'books', 'movies', 'cars', 'home', 'garden', 'tech',
+  'science', 'art', 'design']
+const topLevelDomains = ['com', 'org', 'net', 'io', 'co.uk', 'de', 'fr']
+
+// Deterministic pseudo random numbers in [0, 1) (mulberry32), so a seed
+// always gives the same profile.
+const random = (seed) => {
+  let state = seed >>> 0
+  return () => {
+    state = (state + 0x6D2B79F5) >>> 0
+    let t = state
+    t = Math.imul(t ^ (t >>> 15), t | 1)
+    t ^= t + Math.imul(t ^ (t >>> 7), t | 61)
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296
+  }
+}
+
+const pick = (rng, list) => list[Math.floor(rng() * list.length)]
+// Index in [0, count) where low indices are much more likely, like the
+// popularity of sites.
+const skewed = (rng, count) => Math.floor(count * Math.pow(rng(), 3))
+const capitalize = (word) => word[0].toUpperCase() + word.substring(1)
+
+// Microseconds since 1601, as Chromium stores times. More than fit in a
+// double.
+const chromeTime = (unixMs) => BigInt(Math.round(unixMs)) * 1000n + 11644473600000000n
+
+// Numbers, strings, or { sql } for an SQL expression.
+const sqlValue = (value) => typeof value === 'number' || typeof value === 'bigint' ? String(value)
+  : typeof value === 'string' ? `'${value.replace(/'/g, "''")}'`
+    : value.sql
+
+const insertRows = (table, columns, rows, verb = 'INSERT') => {
+  const statements = []
+  for (let i = 0; i < rows.length; i += rowsPerInsert) {
+    const values = rows.slice(i, i + rowsPerInsert).map((row) => `(${row.map(sqlValue).join(',')})`)
+    statements.push(`${verb} INTO ${table} (${columns.join(',')}) VALUES\n${values.join(',\n')};`)
+  }
+  return statements.join('\n')
+}
+
+const makeDomains = (rng, count) => Array.from({ length: count },
+  (value, i) => `${pick(rng, words)}${pick(rng, words)}${i}.${pick(rng, topLevelDomains)}`)
+
+// Rows of the urls and visits tables of History: the home page of every
+// domain, then pages of popular domains, each visited a few times over the
+// last |historyDays|.
+const historySql = (rng, preset, domains, nowMs) => {
+  const urls = []
+  const visits = []
+  for (let id = 1; id <= preset.history; id++) {
+    const domain = id <= domains.length ? domains[id - 1] : domains[skewed(rng, domains.length)]
+    const page = id <= domains.length ? '' : `${pick(rng, words)}/${id}`
+    const visitCount = 1 + skewed(rng, 10)
+    const typedCount = rng() < 0.05 ? Math.min(visitCount, 1 + skewed(rng, 5)) : 0
+    let lastVisit = 0
+    for (let visit = 0; visit < visitCount; visit++) {
+      const visitTime = nowMs - rng() * historyDays * dayMs
+      lastVisit = Math.max(lastVisit, visitTime)
+      visits.push([visits.length + 1, id, chromeTime(visitTime), 0,
+        visit < typedCount ? typedTransition : linkTransition, 0, 0])
+    }
+    urls.push([id, `https://${domain}/${page}`,
+      `${capitalize(pick(rng, words))} ${pick(rng, words)} - ${domain}`,
+      visitCount, typedCount, chromeTime(lastVisit), 0])
+  }
+  return [
+    insertRows('urls', ['id', 'url', 'title', 'visit_count', 'typed_count', 'last_visit_time', 'hidden'], urls),
+    insertRows('visits', ['id', 'url', 'visit_time', 'from_visit', 'transition', 'segment_id', 'visit_duration'], visits)
+  ].join('\n')
+}
+
+// The Bookmarks file: a few bookmarks on the bookmarks bar, the rest in
+// folders of up to 100 bookmarks, grouped by ten under Other bookmarks.
+const bookmarksJson = (rng, preset, domains, nowMs) => {
+  let nextId = 4
+  const bookmark = () => {
+    const domain = domains[skewed(rng, domains.length)]
+    return {
+      date_added: chromeTime(nowMs - rng() * 365 * dayMs).toString(),
+      id: String(nextId++),
+      name: `${capitalize(pick(rng, words))} ${pick(rng, words)} - ${domain}`,
+      type: 'url',
+      url: `https://${domain}/${pick(rng, words)}`
+    }
+  }
+  const folder = (id, name, children) => ({
+    children,
+    date_added: chromeTime(nowMs - historyDays * dayMs).toString(),
+    date_modified: chromeTime(nowMs).toString(),
+    id: String(id),
+    name,
+    type: 'folder'
+  })
+  let remaining = preset.bookmarks
+  const bar = []
+  for (; remaining > 0 && bar.length < 20; remaining--) {
+    bar.push(bookmark())
+  }
+  const other = []
+  while (remaining > 0) {
+    const parent = folder(nextId++, `${capitalize(pick(rng, words))} ${other.length + 1}`, [])
+    while (remaining > 0 && parent.children.length < 10) {
+      const child = folder(nextId++, `${capitalize(pick(rng, words))} ${parent.children.length + 1}`, [])
+      for (; remaining > 0 && child.children.length < 100; remaining--) {
+        child.children.push(bookmark())
+      }
+      parent.children.push(child)
+    }
+    other.push(parent)
+  }
+  // Without a checksum Chromium loads the file as is.
+  return {
+    roots: {
+      bookmark_bar: folder(1, 'Bookmarks bar', bar),
+      other: folder(2, 'Other bookmarks', other),
+      synced: folder(3, 'Mobile bookmarks', [])
+    },
+    version: 1
+  }
+}
+
+// The reconcile stamp of the current Brave Rewards period, in seconds: the
+// one of the ledger state the browser wrote, or the end of a period starting
+// now, as the ledger sets it for a new wallet, when there is no state yet.
+const reconcileStamp = (profileDir, nowMs) => {
+  const ledgerState = path.join(profileDir, 'ledger_state')
+  const state = fs.existsSync(ledgerState) ? fs.readJsonSync(ledgerState, { throws: false }) : null
+  if (state && state.reconcileStamp) {
+    return state.reconcileStamp
+  }
+  console.log('Brave Rewards has no ledger state yet, the publisher visits are stamped with a period starting now')
+  return Math.floor((nowMs + reconcilePeriodDays * dayMs) / 1000)
+}
+
+// Rows of the Brave Rewards publisher database: the most visited domains as
+// publishers, with the time spent on them in the reconcile period ending at
+// |reconcileStamp|.
+const publishersSql = (rng, preset, domains, reconcileStamp) => {
+  const publishers = domains.slice(0, preset.publishers)
+  return [
+    insertRows('publisher_info', ['publisher_id', 'verified', 'excluded', 'name', 'favIcon', 'url', 'provider'],
+      publishers.map((domain) => [domain, rng() < 0.3 ? 1 : 0, 0, domain, '', `https://${domain}/`, '']),
+      'INSERT OR REPLACE'),
+    insertRows('activity_info', ['publisher_id', 'duration', 'visits', 'score', 'percent', 'weight', 'reconcile_stamp'],
+      publishers.map((domain) => {
+        const visits = 1 + skewed(rng, 50)
+        const duration = visits * (10 + Math.floor(rng() * 300))
+        return [domain, duration, visits, duration / 1000, 0, 0, reconcileStamp]
+      }), 'INSERT OR REPLACE')
+  ].join('\n')
+}
+
+const runSql = (database, sql) => {
+  const python = spawnSync('python', [path.join(config.rootDir, 'scripts', 'seedProfileDb.py'), database],
+    { input: sql, maxBuffer: 64 * 1024 * 1024 })
+  if (python.error || python.status !== 0) {
+    throw new Error(`Could not write ${database}: ` +
+      (python.error ? python.error.message : python.stderr.toString()))
+  }
+}
+
+// Runs the browser once on |userDataDir| so it creates its databases, which
+// are then filled instead of created here and so always have the schema of
+// the build.
+const createProfile = async (binary, userDataDir) => {
+  const historyFile = path.join(userDataDir, 'Default', 'History')
+  writePreferences(userDataDir, { brave: { rewards: { enabled: true } } })
+  await withBenchmarkEnvironment(['--user-data-dir=' + userDataDir, '--host-resolver-rules=MAP * ~NOTFOUND'],
+    async (args, env) => {
+      const browser = new BrowserProcess(binary, args, { env, stdio: 'ignore' })
+      const deadline = Date.now() + profileCreationTimeoutMs
+      while (!browser.exited && Date.now() < deadline && !fs.existsSync(historyFile)) {
+        await BrowserProcess.sleep(BrowserProcess.pollIntervalMs)
+      }
+      await BrowserProcess.sleep(profileSettleMs)
+      await browser.stop()
+    })
+  if (!fs.existsSync(historyFile)) {
+    throw new Error(`${binary} did not create a profile in ${userDataDir}`)
+  }
+}
+
+// Generates the profile of |size| from |seed| into |userDataDir|, replacing
+// what was there.
+const generateProfile = async (binary, userDataDir, size, seed) => {
+  const preset = presets[size]
+  if (!preset) {
+    throw new Error(`Unknown profile size "${size}", use ${Object.keys(presets).join(', ')}`)
+  }
+  const profileDir = path.join(userDataDir, 'Default')
+  fs.removeSync(userDataDir)
+  console.log(`Creating a ${size} profile in ${userDataDir}...`)
+  await createProfile(binary, userDataDir)
+
+  const rng = random(seed)
+  const nowMs = Date.now()
+  const domains = makeDomains(rng, preset.domains)
+  console.log(`Adding ${preset.history} history entries over ${preset.domains} domains...`)
+  runSql(path.join(profileDir, 'History'), historySql(rng, preset, domains, nowMs))
+  console.log(`Adding ${preset.bookmarks} bookmarks...`)
+  fs.writeJsonSync(path.join(profileDir, 'Bookmarks'), bookmarksJson(rng, preset, domains, nowMs), { spaces: 3 })
+  const publisherDb = path.join(profileDir, 'publisher_info_db')
+  if (fs.existsSync(publisherDb)) {
+    console.log(`Adding ${preset.publishers} Brave Rewards publishers...`)
+    runSql(publisherDb, publishersSql(rng, preset, domains, reconcileStamp(profileDir, nowMs)))
+  } else {
+    console.log('Brave Rewards did not create its publisher database, the profile has no publisher visits')
+  }
+  fs.writeJsonSync(path.join(userDataDir, 'brave-seed.json'),
+    { size, seed, created: new Date(nowMs).toISOString(), preset }, { spaces: 2 })
+}
+
+const seedProfile = (buildConfig = config.defaultBuildConfig, options) => {
+  config.buildConfig = buildConfig
+  config.update(options)
+
+  const size = (options.size || 'medium').toLowerCase()
+  const userDataDirName = options.user_data_dir_name || `brave-seed-${size}`
+  const userDataDir = start.unescapeShellArg(start.getUserDataDir(userDataDirName))
+  return generateProfile(start.unescapeShellArg(start.getOutputPath(options)), userDataDir, size,
+    parseInt(options.seed, 10)).then(() => {
+    console.log(`Seeded profile ready, use it with \`npm run start -- --user_data_dir_name=${userDataDirName}\` ` +
+      `or --bench_profile=${userDataDir}`)
+  }, (e) => {
+    console.error(e.message)
+    process.exit(1)
+  })
+}
+
+module.exports = seedProfile
+module.exports.presets = presets
+module.exports.random = random
+module.exports.historySql = historySql
+module.exports.bookmarksJson = bookmarksJson
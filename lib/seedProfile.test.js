@@ -0,0 +1,61 @@
+const path = require('path')
+const os = require('os')
+const fs = require('fs-extra')
+const { spawnSync } = require('child_process')
+const { presets, random, historySql, bookmarksJson } = require('./seedProfile')
+
+const preset = { domains: 20, history: 100, bookmarks: 250, publishers: 5 }
+const domains = Array.from({ length: preset.domains }, (value, i) => `site${i}.com`)
+const nowMs = Date.UTC(2019, 9, 1)
+
+const countBookmarks = (node) => node.type === 'url' ? 1
+  : node.children.reduce((sum, child) => sum + countBookmarks(child), 0)
+
+test('presets grow with size', function () {
+  expect(presets.large.history).toBe(200000)
+  expect(presets.large.bookmarks).toBe(20000)
+  expect(presets.small.publishers).toBeLessThanOrEqual(presets.small.domains)
+})
+
+test('generates the same profile data from the same seed', function () {
+  expect(historySql(random(7), preset, domains, nowMs)).toBe(historySql(random(7), preset, domains, nowMs))
+  expect(historySql(random(7), preset, domains, nowMs)).not.toBe(historySql(random(8), preset, domains, nowMs))
+})
+
+test('generates bookmarks in folders', function () {
+  const bookmarks = bookmarksJson(random(1), preset, domains, nowMs)
+  expect(bookmarks.roots.bookmark_bar.children.length).toBe(20)
+  const total = Object.values(bookmarks.roots).reduce((sum, root) => sum + countBookmarks(root), 0)
+  expect(total).toBe(250)
+  const ids = new Set()
+  const collect = (node) => { ids.add(node.id); (node.children || []).forEach(collect) }
+  Object.values(bookmarks.roots).forEach(collect)
+  // The three roots, and one folder holding three folders of up to 100.
+  expect(ids.size).toBe(250 + 3 + 4)
+})
+
+test('generates history rows which fit the History schema', function () {
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'seed-profile-test-'))
+  const database = path.join(dir, 'History')
+  const schema = `CREATE TABLE urls(id INTEGER PRIMARY KEY AUTOINCREMENT, url LONGVARCHAR, title LONGVARCHAR,
+    visit_count INTEGER DEFAULT 0 NOT NULL, typed_count INTEGER DEFAULT 0 NOT NULL,
+    last_visit_time INTEGER NOT NULL, hidden INTEGER DEFAULT 0 NOT NULL);
+  CREATE TABLE visits(id INTEGER PRIMARY KEY, url INTEGER NOT NULL, visit_time INTEGER NOT NULL,
+    from_visit INTEGER, transition INTEGER DEFAULT 0 NOT NULL, segment_id INTEGER,
+    visit_duration INTEGER DEFAULT 0 NOT NULL, incremented_omnibox_typed_score BOOLEAN DEFAULT FALSE NOT NULL);`
+  const script = path.join(__dirname, '..', 'scripts', 'seedProfileDb.py')
+  const run = (sql) => spawnSync('python', [script, database], { input: sql })
+  try {
+    expect(run(schema).status).toBe(0)
+    expect(run(historySql(random(1), preset, domains, nowMs)).status).toBe(0)
+    const count = spawnSync('python', ['-c',
+      'import sqlite3, sys; db = sqlite3.connect(sys.argv[1]); print(db.execute("SELECT COUNT(*), MIN(last_visit_time) FROM urls").fetchone())',
+      database])
+    const [urls, oldest] = count.stdout.toString().replace(/[()\s]/g, '').split(',').map(Number)
+    expect(urls).toBe(100)
+    // Within the last 90 days, in microseconds since 1601.
+    expect(oldest).toBeGreaterThan((nowMs - 90 * 86400000 + 11644473600000) * 1000)
+  } finally {
+    fs.removeSync(dir)
+  }
+})
@@ -0,0 +1,546 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const zlib = require('zlib')
+const readline = require('readline')
+const fs = require('fs-extra')
+const { spawn, spawnSync } = require('child_process')
+const config = require('../lib/config')
+const util = require('../lib/util')
+const { parseSize, formatSize } = require('./gcOut')
+
+const defaultTop = 50
+// Number of entries of each ranking printed to the console.
+const printedTop = 10
+
+// The files of the out dir which create_dist packages on Linux.
+const artifactDirs = ['', 'locales', 'swiftshader']
+const isArtifact = (name) => name === 'brave' || /\.(so|pak|bin|dat)$/.test(name)
+// Data files which are not broken down, and where they come from.
+const dataFileSources = {
+  'icudtl.dat': 'third_party/icu',
+  'natives_blob.bin': 'v8',
+  'snapshot_blob.bin': 'v8',
+  'v8_context_snapshot.bin': 'v8'
+}
+
+const listArtifacts = (outDir) => {
+  const files = []
+  for (const dir of artifactDirs) {
+    const fullDir = path.join(outDir, dir)
+    if (!fs.existsSync(fullDir)) {
+      continue
+    }
+    for (const name of fs.readdirSync(fullDir).sort()) {
+      if (isArtifact(name) && fs.statSync(path.join(fullDir, name)).isFile()) {
+        files.push(path.posix.join(dir, name))
+      }
+    }
+  }
+  return files
+}
+
+// The source directory of an input of the linker map, which is an object
+// file obj/<label dir>/<label name>/<file>.o, or a member of a static
+// library obj/<label dir>/lib<name>.a. Members of thin archives keep their
+// path.
+const objectSourceDir = (input) => {
+  if (input.startsWith('<')) {
+    return '(linker)'
+  }
+  let object = input
+  let inArchive = false
+  const member = /^(.*?)\((.*)\)$/.exec(input)
+  if (member) {
+    inArchive = !member[2].includes('/')
+    object = inArchive ? member[1] : member[2]
+  }
+  object = object.replace(/\\/g, '/')
+  if (!object.startsWith('obj/')) {
+    return '(external)'
+  }
+  const dir = path.posix.dirname(object.substring('obj/'.length))
+  const labelDir = inArchive ? dir : path.posix.dirname(dir)
+  return labelDir === '.' ? '(root)' : labelDir
+}
+
+// The source directory of |file| of the debug info, which is relative to
+// |outDir| or absolute. Generated files count for the directory they are
+// generated for.
+const debugInfoSourceDir = (file, outDir, srcDir) => {
+  const relative = path.relative(srcDir, path.resolve(outDir, file)).replace(/\\/g, '/')
+  if (relative.startsWith('../') || path.isAbsolute(relative)) {
+    return '(external)'
+  }
+  const genDir = path.relative(srcDir, path.join(outDir, 'gen')).replace(/\\/g, '/') + '/'
+  const source = relative.startsWith(genDir) ? relative.substring(genDir.length) : relative
+  const dir = path.posix.dirname(source)
+  return dir === '.' ? '(root)' : dir
+}
+
+// Top two levels of |sourceDir|, such as third_party/blink.
+const directoryOf = (sourceDir) =>
+  sourceDir.startsWith('(') ? sourceDir : sourceDir.split('/').slice(0, 2).join('/')
+
+// The brave/ component of |sourceDir|, such as brave/components/brave_shields
+// or brave/browser/ui, or null outside of brave/.
+const braveComponentOf = (sourceDir) =>
+  sourceDir === 'brave' || sourceDir.startsWith('brave/') ? sourceDir.split('/').slice(0, 3).join('/') : null
+
+const readLines = (input, onLine) => new Promise((resolve, reject) => {
+  input.on('error', reject)
+  readline.createInterface({ input, crlfDelay: Infinity })
+    .on('line', onLine)
+    .on('close', resolve)
+})
+
+// Reads the input sections of an lld linker map (--Map), with the output
+// section they went to and the first symbol they define:
+//              VMA              LMA     Size Align Out     In      Symbol
+//           201000           201000   1a3f2b    16 .text
+//           201000           201000       2c     4         obj/base/base/file_path.o:(.text._ZN4base8FilePathC2Ev)
+//           201000           201000        0     1                 base::FilePath::FilePath()
+// Sections which take no space in the file, such as .bss or the debug info,
+// are skipped.
+class LinkerMapParser {
+  constructor () {
+    this.columns = null
+    this.section = null
+    this.input = null
+    this.items = []
+  }
+
+  line (text) {
+    if (!this.columns) {
+      const names = text.trim().split(/\s+/)
+      if (names.includes('Size') && names.includes('Symbol')) {
+        const numeric = names.indexOf('Out')
+        this.columns = {
+          size: names.indexOf('Size'),
+          in: text.indexOf(' In ') + 1,
+          symbol: text.indexOf('Symbol'),
+          numeric: new RegExp(`^\\s*(?:[0-9a-f]+\\s+){${numeric}}`, 'i')
+        }
+      }
+      return
+    }
+    const numbers = this.columns.numeric.exec(text)
+    if (!numbers) {
+      return
+    }
+    const fields = numbers[0].trim().split(/\s+/)
+    const address = parseInt(fields[0], 16)
+    const size = parseInt(fields[this.columns.size], 16)
+    const name = text.substring(numbers[0].length).trim()
+    const column = numbers[0].length
+    if (column >= this.columns.symbol) {
+      if (this.input && !this.input.symbol) {
+        this.input.symbol = name
+      }
+      return
+    }
+    this.flush()
+    if (column < this.columns.in) {
+      this.section = /^\.t?bss\b/.test(name) ? null : name
+    } else if (this.section && address && size) {
+      const input = /^(.*):\((.*)\)$/.exec(name)
+      this.input = { object: input ? input[1] : name, inputSection: input ? input[2] : name, size }
+    }
+  }
+
+  flush () {
+    if (this.input) {
+      const { object, inputSection, size, symbol } = this.input
+      this.items.push({
+        name: symbol || `[${inputSection} of ${object}]`,
+        size,
+        section: this.section,
+        sourceDir: objectSourceDir(object)
+      })
+    }
+    this.input = null
+  }
+}
+
+const parseLinkerMap = async (mapFile) => {
+  const parser = new LinkerMapParser()
+  let input = fs.createReadStream(mapFile)
+  if (mapFile.endsWith('.gz')) {
+    input = input.pipe(zlib.createGunzip())
+  }
+  await readLines(input, (line) => parser.line(line))
+  parser.flush()
+  return parser.items
+}
+
+// nm symbol types by the section they live in. bss symbols take no space in
+// the file.
+const nmSections = { t: '.text', w: '.text', i: '.text', r: '.rodata', d: '.data', g: '.data', v: '.data' }
+
+// Parses a line of `nm --print-size --demangle --line-numbers`:
+//   0000000000401126 000000000000000b T main	/src/out/Release/../../brave/app/main.cc:3
+const parseNmLine = (line, outDir, srcDir) => {
+  const symbol = /^[0-9a-f]+\s+([0-9a-f]+)\s+(\w)\s+([^\t]*)(?:\t(.*?)(?::\d+)?)?\s*$/i.exec(line)
+  if (!symbol || /^b$/i.test(symbol[2])) {
+    return null
+  }
+  const file = symbol[4] && !symbol[4].startsWith('??') ? symbol[4] : null
+  return {
+    name: symbol[3],
+    size: parseInt(symbol[1], 16),
+    section: nmSections[symbol[2].toLowerCase()] || 'other',
+    sourceDir: file ? debugInfoSourceDir(file, outDir, srcDir) : '(no debug info)'
+  }
+}
+
+// Symbols of |file| with their source file from its debug info. Reading the
+// debug info of brave takes a while, a linker map is much faster.
+const nmSymbols = (file, outDir, srcDir) => new Promise((resolve, reject) => {
+  const items = []
+  const nm = spawn('nm', ['--print-size', '--size-sort', '--demangle', '--line-numbers', '--defined-only', file],
+    { stdio: ['ignore', 'pipe', 'ignore'] })
+  nm.on('error', reject)
+  readLines(nm.stdout, (line) => {
+    const item = parseNmLine(line, outDir, srcDir)
+    if (item) {
+      items.push(item)
+    }
+  }).then(() => nm.on('close', (code) => {
+    if (code !== 0) {
+      console.log(`nm could not read the symbols of ${file}, it is not broken down`)
+    }
+    resolve(items)
+  }), reject)
+})
+
+// Sizes of the sections of an ELF |file| which are loaded from the file.
+const elfSections = (file) => {
+  const readelf = spawnSync('readelf', ['-S', '--wide', file], { encoding: 'utf8', maxBuffer: 16 * 1024 * 1024 })
+  if (readelf.error || readelf.status !== 0) {
+    return null
+  }
+  const sections = {}
+  for (const line of readelf.stdout.split('\n')) {
+    const header = /^\s*\[\s*\d+\]\s+(.*)$/.exec(line)
+    if (!header) {
+      continue
+    }
+    // Name Type Address Off Size ES [Flg] Lk Inf Al
+    const fields = header[1].trim().split(/\s+/)
+    const flags = fields.length >= 10 ? fields[6] : ''
+    if (fields[1] !== 'NOBITS' && flags.includes('A')) {
+      sections[fields[0]] = parseInt(fields[4], 16)
+    }
+  }
+  return sections
+}
+
+const isElf = (file) => {
+  const magic = Buffer.alloc(4)
+  const fd = fs.openSync(file, 'r')
+  try {
+    fs.readSync(fd, magic, 0, 4, 0)
+  } finally {
+    fs.closeSync(fd)
+  }
+  return magic.toString('latin1') === '\x7fELF'
+}
+
+// Sizes of the resources of a .pak file, by resource id. See
+// tools/grit/grit/format/data_pack.py for versions 4 and 5 of the format.
+// Aliases share the data of another resource.
+const parsePak = (buffer) => {
+  const version = buffer.readUInt32LE(0)
+  let count
+  let entriesOffset
+  if (version === 4) {
+    count = buffer.readUInt32LE(4)
+    entriesOffset = 9
+  } else if (version === 5) {
+    count = buffer.readUInt16LE(8)
+    entriesOffset = 12
+  } else {
+    throw new Error(`Unsupported pak version ${version}`)
+  }
+  const entries = []
+  // Every entry is a uint16 id and the uint32 offset of its data, which ends
+  // where the data of the next one starts.
+  for (let i = 0; i < count; i++) {
+    const offset = entriesOffset + i * 6
+    entries.push({
+      id: buffer.readUInt16LE(offset),
+      size: buffer.readUInt32LE(offset + 8) - buffer.readUInt32LE(offset + 2)
+    })
+  }
+  return { version, entries }
+}
+
+// Names of the resources by id, with the directory of the grit header which
+// defines them, from gen/**/grit/*.h.
+const resourceNames = (outDir) => {
+  const names = new Map()
+  const genDir = path.join(outDir, 'gen')
+  if (!fs.existsSync(genDir)) {
+    return names
+  }
+  const headers = util.walkSync(genDir, (file) => file.endsWith('.h'))
+    .filter((file) => path.basename(path.dirname(file)) === 'grit')
+  for (const header of headers) {
+    // The header of brave/components/foo/resources is in gen/brave/components/foo/grit.
+    const sourceDir = path.dirname(path.relative(genDir, path.dirname(header))).replace(/\\/g, '/')
+    for (const line of fs.readFileSync(header, 'utf8').split('\n')) {
+      const define = /^#define\s+(\w+)\s+\(?(\d+)\)?\s*$/.exec(line)
+      if (define) {
+        names.set(parseInt(define[2], 10), { name: define[1], sourceDir: sourceDir === '.' ? '(root)' : sourceDir })
+      }
+    }
+  }
+  return names
+}
+
+const sumSizes = (sizes) => sizes.reduce((sum, size) => sum + size, 0)
+
+// Breaks |file| of |outDir| down into items with a name, size and source
+// directory. The items add up to the size of the file, or for ELF files to
+// the size of their loaded sections, which is what stays when they are
+// stripped for packaging.
+const analyzeFile = async (file, outDir, srcDir, resources) => {
+  const fullPath = path.join(outDir, file)
+  const fileSize = fs.statSync(fullPath).size
+  const analysis = { size: fileSize, file_size: fileSize, source: 'file size', items: [] }
+  if (file.endsWith('.pak')) {
+    analysis.source = 'pak'
+    for (const { id, size } of parsePak(fs.readFileSync(fullPath)).entries) {
+      const resource = resources().get(id)
+      analysis.items.push({
+        name: resource ? resource.name : `resource ${id}`,
+        size,
+        section: 'resources',
+        sourceDir: resource ? resource.sourceDir : '(unknown resources)'
+      })
+    }
+  } else if (isElf(fullPath)) {
+    const sections = elfSections(fullPath)
+    if (sections) {
+      analysis.sections = sections
+      analysis.size = sumSizes(Object.values(sections))
+    }
+    const mapFile = [`${fullPath}.map.gz`, `${fullPath}.map`].find((map) => fs.existsSync(map))
+    if (mapFile) {
+      analysis.source = 'linker map'
+      analysis.items = await parseLinkerMap(mapFile)
+    } else {
+      analysis.source = 'debug info'
+      analysis.items = await nmSymbols(fullPath, outDir, srcDir)
+    }
+  } else {
+    analysis.items.push({ name: file, size: fileSize, section: 'data', sourceDir: dataFileSources[file] || '(data)' })
+  }
+  // Headers, indexes, symbol tables and what the debug info does not cover.
+  const unattributed = analysis.size - sumSizes(analysis.items.map((item) => item.size))
+  if (unattributed > 0) {
+    analysis.items.push({ name: '(unattributed)', size: unattributed, section: 'other', sourceDir: '(unattributed)' })
+  }
+  return analysis
+}
+
+// Analyzes the artifacts of |outDir|, resolves to the analysis by file.
+const analyzeOutDir = async (outDir) => {
+  // Debug info paths are relative to the src dir of the out dir, which for
+  // a baseline build can be another checkout.
+  const srcDir = path.resolve(outDir, '..', '..')
+  let resources = null
+  const lazyResources = () => {
+    resources = resources || resourceNames(outDir)
+    return resources
+  }
+  const files = {}
+  for (const file of listArtifacts(outDir)) {
+    console.log(`Analyzing ${path.join(outDir, file)}...`)
+    files[file] = await analyzeFile(file, outDir, srcDir, lazyResources)
+  }
+  if (!Object.keys(files).length) {
+    throw new Error(`${outDir} has no brave, .pak or shared library files`)
+  }
+  return files
+}
+
+// Sums the item sizes of |files| by |key| of the file and item, skipping
+// items without a key.
+const totalsBy = (files, key) => {
+  const totals = new Map()
+  for (const [file, { items }] of Object.entries(files)) {
+    for (const item of items) {
+      const name = key(file, item)
+      if (name !== null) {
+        totals.set(name, (totals.get(name) || 0) + item.size)
+      }
+    }
+  }
+  return totals
+}
+
+const breakdowns = {
+  files: (files) => new Map(Object.entries(files).map(([file, { size }]) => [file, size])),
+  directories: (files) => totalsBy(files, (file, item) => directoryOf(item.sourceDir)),
+  components: (files) => totalsBy(files, (file, item) => braveComponentOf(item.sourceDir)),
+  symbols: (files) => totalsBy(files, (file, item) => `${file}: ${item.name}`)
+}
+
+// The |top| largest entries of |totals|, all of them without |top|.
+const ranked = (totals, top) => Array.from(totals, ([name, size]) => ({ name, size }))
+  .sort((a, b) => b.size - a.size)
+  .slice(0, top || undefined)
+
+// The |top| largest changes from |before| to |after|.
+const changes = (before, after, top) => {
+  const names = new Set([...before.keys(), ...after.keys()])
+  return Array.from(names, (name) => {
+    const beforeSize = before.get(name) || 0
+    const afterSize = after.get(name) || 0
+    return { name, before: beforeSize, after: afterSize, delta: afterSize - beforeSize }
+  }).filter((change) => change.delta !== 0)
+    .sort((a, b) => Math.abs(b.delta) - Math.abs(a.delta))
+    .slice(0, top || undefined)
+}
+
+const totalSize = (files) => sumSizes(Object.values(files).map((file) => file.size))
+
+// Size of the items of |files| under the source directory |prefix|.
+const sizeUnder = (files, prefix) => sumSizes(Array.from(totalsBy(files, (file, item) =>
+  item.sourceDir === prefix || item.sourceDir.startsWith(prefix + '/') ? prefix : null).values()))
+
+// Checks |files|, and their growth from |baseline| when there is one,
+// against |budget|, which has the maximum sizes of all files together, of
+// files and of source directories, and the maximum growth of those:
+//   {
+//     "total": "250M",
+//     "files": { "brave": "180M", "resources.pak": "15M" },
+//     "directories": { "brave/components/brave_rewards": "4M" },
+//     "growth": { "total": "1M", "files": { "brave": "512K" }, "directories": {} }
+//   }
+// Returns the violations.
+const checkBudget = (budget, files, baseline) => {
+  const measures = (limits, analysis) => [].concat(
+    limits.total === undefined ? [] : [{ name: 'total', limit: limits.total, size: () => totalSize(analysis) }],
+    Object.entries(limits.files || {}).map(([file, limit]) =>
+      ({ name: file, limit, size: () => analysis[file] ? analysis[file].size : 0 })),
+    Object.entries(limits.directories || {}).map(([dir, limit]) =>
+      ({ name: dir, limit, size: () => sizeUnder(analysis, dir) })))
+
+  const violations = []
+  for (const { name, limit, size } of measures(budget, files)) {
+    if (size() > parseSize(limit)) {
+      violations.push({ name, kind: 'size', limit: parseSize(limit), size: size() })
+    }
+  }
+  if (budget.growth && baseline) {
+    const before = measures(budget.growth, baseline)
+    measures(budget.growth, files).forEach(({ name, limit, size }, index) => {
+      const growth = size() - before[index].size()
+      if (growth > parseSize(limit)) {
+        violations.push({ name, kind: 'growth', limit: parseSize(limit), size: growth })
+      }
+    })
+  } else if (budget.growth) {
+    console.log('The growth limits of the budget need a --baseline, they are not checked')
+  }
+  return violations
+}
+
+const signedSize = (bytes) => (bytes < 0 ? '-' : '+') + formatSize(Math.abs(bytes))
+
+const resolveOutDir = (outDir) => {
+  if (fs.existsSync(outDir)) {
+    return path.resolve(outDir)
+  }
+  // A build config name like Release.
+  const configOutDir = path.join(config.srcDir, 'out', outDir)
+  if (fs.existsSync(configOutDir)) {
+    return configOutDir
+  }
+  throw new Error(`There is no out dir ${outDir}`)
+}
+
+// Breaks the size of brave, the .pak files and the shared libraries of
+// |outDir| down by symbol or resource, source directory and brave/
+// component, from the linker maps (generate_linker_map=true) or the debug
+// info of the binaries and the grit headers of the resources. Compares it
+// with |options.baseline| and checks it against the |options.budget| file.
+// Writes the report to |options.output|.
+const sizeReport = async (outDir, options) => {
+  outDir = resolveOutDir(outDir)
+  const top = parseInt(options.top, 10) || defaultTop
+  const files = await analyzeOutDir(outDir)
+  const report = {
+    out_dir: outDir,
+    created: new Date().toISOString(),
+    total: totalSize(files),
+    files: {},
+    components: ranked(breakdowns.components(files)),
+    directories: ranked(breakdowns.directories(files)),
+    symbols: ranked(breakdowns.symbols(files), top)
+  }
+  for (const [file, { size, file_size: fileSize, source, sections }] of Object.entries(files)) {
+    report.files[file] = { size, file_size: fileSize, source, sections }
+  }
+
+  let baseline = null
+  if (options.baseline) {
+    const baselineDir = resolveOutDir(options.baseline)
+    baseline = await analyzeOutDir(baselineDir)
+    report.baseline = baselineDir
+    report.diff = { total: { before: totalSize(baseline), after: report.total, delta: report.total - totalSize(baseline) } }
+    for (const [breakdown, totals] of Object.entries(breakdowns)) {
+      report.diff[breakdown] = changes(totals(baseline), totals(files), breakdown === 'files' ? 0 : top)
+    }
+  }
+  if (options.budget) {
+    const budget = fs.readJsonSync(options.budget)
+    report.budget = { file: path.resolve(options.budget), violations: checkBudget(budget, files, baseline) }
+  }
+  const output = options.output || 'size-report.json'
+  fs.writeJsonSync(output, report, { spaces: 2 })
+
+  for (const [file, { size, source }] of Object.entries(report.files)) {
+    console.log(`${file}: ${formatSize(size)} (${source})`)
+  }
+  console.log(`total: ${formatSize(report.total)}` + (report.diff ? ` (${signedSize(report.diff.total.delta)})` : ''))
+  console.log('Largest brave/ components:')
+  report.components.slice(0, printedTop).forEach(({ name, size }) => console.log(`  ${name}: ${formatSize(size)}`))
+  console.log('Largest source directories:')
+  report.directories.slice(0, printedTop).forEach(({ name, size }) => console.log(`  ${name}: ${formatSize(size)}`))
+  if (report.diff) {
+    for (const breakdown of ['files', 'components', 'directories', 'symbols']) {
+      console.log(`Largest changes of ${breakdown} from ${report.baseline}:`)
+      report.diff[breakdown].slice(0, printedTop).forEach(({ name, delta }) =>
+        console.log(`  ${name}: ${signedSize(delta)}`))
+    }
+  }
+  console.log(`size report written to ${output}`)
+  if (report.budget) {
+    for (const { name, kind, limit, size } of report.budget.violations) {
+      console.error(`size budget exceeded: ${kind} of ${name} is ${formatSize(size)}, the limit is ${formatSize(limit)}`)
+    }
+    if (report.budget.violations.length) {
+      process.exitCode = 1
+    } else {
+      console.log('size budget met')
+    }
+  }
+}
+
+module.exports = (outDir, options) => sizeReport(outDir, options).catch((e) => {
+  console.error(e.message)
+  process.exit(1)
+})
+module.exports.LinkerMapParser = LinkerMapParser
+module.exports.objectSourceDir = objectSourceDir
+module.exports.parseNmLine = parseNmLine
+module.exports.parsePak = parsePak
+module.exports.braveComponentOf = braveComponentOf
+module.exports.changes = changes
+module.exports.checkBudget = checkBudget
@@ -0,0 +1,115 @@
+const sizeReport = require('./sizeReport')
+
+test('reads input sections and their first symbol from an lld map', function () {
+  const parser = new sizeReport.LinkerMapParser()
+  const map = `             VMA              LMA     Size Align Out     In      Symbol
+          2002a0           2002a0       1c     1 .interp
+          2002a0           2002a0       1c     1         <internal>:(.interp)
+          201000           201000     1000    16 .text
+          201000           201000       2c     4         obj/base/base/file_path.o:(.text._ZN4base8FilePathC2Ev)
+          201000           201000        0     1                 base::FilePath::FilePath()
+          201030           201030       40    16         obj/brave/components/brave_shields/browser/browser/ad_block_service.o:(.text._ZN5brave14AdBlockService4InitEv)
+          201030           201030        0     1                 brave::AdBlockService::Init()
+          201030           201030        0     1                 brave::AdBlockService::InitAlias()
+          300000           300000       20    16 .rodata
+          300000           300000       20     1         obj/third_party/zlib/libchrome_zlib.a(adler32.o):(.rodata.str1.1)
+          400000           400000     8000    64 .bss
+          400000           400000     8000    64         obj/base/base/memory.o:(.bss._ZN4base6bufferE)
+               0                0      100     1 .debug_info
+               0                0      100     1         obj/base/base/file_path.o:(.debug_info)
+`
+  map.split('\n').forEach((line) => parser.line(line))
+  parser.flush()
+  expect(parser.items).toEqual([
+    { name: '[.interp of <internal>]', size: 0x1c, section: '.interp', sourceDir: '(linker)' },
+    { name: 'base::FilePath::FilePath()', size: 0x2c, section: '.text', sourceDir: 'base' },
+    { name: 'brave::AdBlockService::Init()', size: 0x40, section: '.text', sourceDir: 'brave/components/brave_shields/browser' },
+    { name: '[.rodata.str1.1 of obj/third_party/zlib/libchrome_zlib.a(adler32.o)]', size: 0x20, section: '.rodata', sourceDir: 'third_party/zlib' }
+  ])
+})
+
+test('attributes linker inputs to the directory of their label', function () {
+  expect(sizeReport.objectSourceDir('obj/content/browser/browser/render_frame_host_impl.o')).toBe('content/browser')
+  expect(sizeReport.objectSourceDir('obj/base/libbase.a(file_path.o)')).toBe('base')
+  expect(sizeReport.objectSourceDir('obj/base/libbase.a(obj/base/base/file_path.o)')).toBe('base')
+  expect(sizeReport.objectSourceDir('../../third_party/llvm-build/Release+Asserts/lib/clang/libclang_rt.builtins.a(udivti3.o)')).toBe('(external)')
+  expect(sizeReport.objectSourceDir('<internal>')).toBe('(linker)')
+})
+
+test('parses nm symbols with their source file', function () {
+  const item = sizeReport.parseNmLine(
+    '0000000000401126 000000000000002b T brave::Init(int, char**)\t/src/out/Release/../../brave/app/brave_main.cc:42',
+    '/src/out/Release', '/src')
+  expect(item).toEqual({ name: 'brave::Init(int, char**)', size: 0x2b, section: '.text', sourceDir: 'brave/app' })
+  expect(sizeReport.parseNmLine('0000000000404000 0000000000000010 r kTable\t../../out/Release/gen/brave/grit/res.cc:3',
+    '/src/out/Release', '/src').sourceDir).toBe('brave/grit')
+  expect(sizeReport.parseNmLine('0000000000404000 0000000000000010 D _edata', '/src/out/Release', '/src').sourceDir)
+    .toBe('(no debug info)')
+  expect(sizeReport.parseNmLine('0000000000405000 0000000000000100 B buffer\t/src/base/a.cc:1', '/src/out/Release', '/src'))
+    .toBe(null)
+})
+
+test('reads resource sizes of version 4 and 5 paks', function () {
+  const pak = (header, entries) => {
+    const data = Buffer.from('aaaabbbbbbbbbb')
+    const index = Buffer.alloc(6 * (entries.length + 1))
+    let offset = header.length + index.length
+    entries.concat([[0, 0]]).forEach(([id, size], i) => {
+      index.writeUInt16LE(id, i * 6)
+      index.writeUInt32LE(offset, i * 6 + 2)
+      offset += size
+    })
+    return Buffer.concat([header, index, data])
+  }
+  const v5 = Buffer.alloc(12)
+  v5.writeUInt32LE(5, 0)
+  v5.writeUInt16LE(2, 8)
+  expect(sizeReport.parsePak(pak(v5, [[101, 4], [102, 10]])).entries).toEqual([{ id: 101, size: 4 }, { id: 102, size: 10 }])
+  const v4 = Buffer.alloc(9)
+  v4.writeUInt32LE(4, 0)
+  v4.writeUInt32LE(1, 4)
+  expect(sizeReport.parsePak(pak(v4, [[7, 14]])).entries).toEqual([{ id: 7, size: 14 }])
+})
+
+test('groups brave/ source directories into components', function () {
+  expect(sizeReport.braveComponentOf('brave/components/brave_rewards/browser')).toBe('brave/components/brave_rewards')
+  expect(sizeReport.braveComponentOf('brave/browser/ui/views')).toBe('brave/browser/ui')
+  expect(sizeReport.braveComponentOf('third_party/blink/renderer')).toBe(null)
+})
+
+test('lists the largest changes first', function () {
+  const before = new Map([['a', 10], ['b', 5], ['c', 7]])
+  const after = new Map([['a', 12], ['c', 7], ['d', 1]])
+  expect(sizeReport.changes(before, after)).toEqual([
+    { name: 'b', before: 5, after: 0, delta: -5 },
+    { name: 'a', before: 10, after: 12, delta: 2 },
+    { name: 'd', before: 0, after: 1, delta: 1 }
+  ])
+  expect(sizeReport.changes(before, after, 1).length).toBe(1)
+})
+
+test('checks sizes and growth against the budget', function () {
+  const analysis = (braveSize, rewardsSize) => ({
+    brave: {
+      size: braveSize + rewardsSize,
+      items: [
+        { name: 'main', size: braveSize, sourceDir: 'brave/app' },
+        { name: 'Rewards', size: rewardsSize, sourceDir: 'brave/components/brave_rewards/browser' }
+      ]
+    },
+    'resources.pak': { size: 1024, items: [{ name: 'IDR_X', size: 1024, sourceDir: 'brave/browser' }] }
+  })
+  const budget = {
+    total: '4K',
+    files: { brave: '3K' },
+    directories: { 'brave/components/brave_rewards': '1K' },
+    growth: { total: '512', directories: { 'brave/components': 100 } }
+  }
+  expect(sizeReport.checkBudget(budget, analysis(1024, 512), analysis(1024, 512))).toEqual([])
+  // The total and brave are at their limits, the rewards component is over it and grew.
+  expect(sizeReport.checkBudget(budget, analysis(1024, 2048), analysis(1024, 512))).toEqual([
+    { name: 'brave/components/brave_rewards', kind: 'size', limit: 1024, size: 2048 },
+    { name: 'total', kind: 'growth', limit: 512, size: 1536 },
+    { name: 'brave/components', kind: 'growth', limit: 100, size: 1536 }
+  ])
+})
@@ -0,0 +1,350 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const os = require('os')
+const crypto = require('crypto')
+const fs = require('fs-extra')
+const BrowserProcess = require('./browserProcess')
+const DevToolsPipe = require('./devtoolsPipe')
+const { withBenchmarkEnvironment } = require('./startupBenchmark')
+const { writePreferences, withReplayServer, navigate, openTab } = require('./benchmarkProfile')
+const { sampleMemory } = require('./processMemory')
+const { linearRegression } = require('./benchmarkStats')
+
+const { sleep } = BrowserProcess
+
+const startupSettleMs = 5000
+const heapSnapshotTimeoutMs = 5 * 60000
+// Tabs kept open for the whole soak and navigated every cycle.
+const persistentTabs = 2
+// Tabs opened, left open for a while and closed every cycle.
+const cycleTabs = 3
+const tabDwellMs = 5000
+const cycleIdleMs = 10000
+// How long a browser whose DevTools pipe failed gets to exit before the
+// failure counts as one of the soak test itself.
+const crashExitTimeoutMs = 5000
+// Memory grows while caches and pools fill up at first, so the samples of
+// the first hour, or the first quarter of shorter soaks, are not part of
+// the growth slopes.
+const maxWarmupHours = 1
+const maxHandleGrowthPerHour = 50
+
+// Rewards and ads are turned on so their timers and background requests
+// run.
+const soakPreferences = {
+  brave: {
+    rewards: { enabled: true },
+    brave_ads: { enabled: true }
+  }
+}
+
+const ledgerStaging = 'https://ledger-staging.mercury.basicattentiontoken.org'
+const balanceStaging = 'https://balance-staging.mercury.basicattentiontoken.org'
+const publishersStaging = 'https://publishers-distro.basicattentiontoken.org'
+const adsStaging = 'https://ads-serve.bravesoftware.com'
+const walletProperties = {
+  altcurrency: 'BAT',
+  probi: '0',
+  balance: '0.0000',
+  unconfirmed: '0.0000',
+  rates: { BAT: 1, USD: 0.2 },
+  parameters: {
+    adFree: { currency: 'BAT', fee: { BAT: 20 }, choices: { BAT: [10, 15, 20, 30, 50, 100] }, range: { BAT: [10, 100] }, days: 30 }
+  }
+}
+// Minimal answers of the Rewards and ads staging servers the soak runs
+// against, so that their periodic requests succeed instead of backing off:
+// an empty wallet, no grants, no publishers and an empty ads catalog.
+const stagingStandIns = [
+  { method: 'GET', prefix: `${ledgerStaging}/v2/wallet/`, status: 200, body: walletProperties },
+  { method: 'GET', prefix: `${balanceStaging}/v2/wallet/`, status: 200, body: walletProperties },
+  { method: 'GET', prefix: `${ledgerStaging}/v4/grants`, status: 200, body: { grants: [] } },
+  { method: 'GET', prefix: `${publishersStaging}/api/v3/public/channels`, status: 200, body: [] },
+  {
+    method: 'GET',
+    prefix: `${adsStaging}/v1/catalog`,
+    status: 200,
+    body: { catalogId: '00000000-0000-0000-0000-000000000000', version: 1, ping: 7200000, campaigns: [], issuers: [] }
+  },
+  { method: 'GET', prefix: `${adsStaging}/v1/confirmation/`, status: 200, body: {} },
+  { method: 'POST', prefix: `${adsStaging}/v1/confirmation/`, status: 201, body: {} }
+]
+
+// Gives the profile in |profileDir| a Rewards wallet unless it has one.
+// Creating a wallet needs signatures of the staging registrar, which a
+// stand-in cannot give, and without a wallet the ledger does little but
+// retry it.
+// The state has the fields the ledger of this release reads.
+const seedRewardsWallet = (profileDir, nowMs) => {
+  const ledgerState = path.join(profileDir, 'ledger_state')
+  if (fs.existsSync(ledgerState)) {
+    return
+  }
+  const bootStamp = Math.floor(nowMs / 1000)
+  fs.outputJsonSync(ledgerState, {
+    walletInfo: {
+      paymentId: crypto.randomBytes(16).toString('hex').replace(/(.{8})(.{4})(.{4})(.{4})(.{12})/, '$1-$2-$3-$4-$5'),
+      addressBAT: '',
+      addressBTC: '',
+      addressCARD_ID: '',
+      addressETH: '',
+      addressLTC: '',
+      keyInfoSeed: crypto.randomBytes(32).toString('base64')
+    },
+    bootStamp,
+    reconcileStamp: bootStamp + 30 * 24 * 60 * 60,
+    personaId: crypto.randomBytes(16).toString('hex'),
+    userId: crypto.randomBytes(16).toString('hex'),
+    registrarVK: '',
+    masterUserToken: '',
+    preFlight: '',
+    fee_currency: 'BAT',
+    settings: 'adFree',
+    fee_amount: 20,
+    user_changed_fee: false,
+    days: 30,
+    transactions: [],
+    ballots: [],
+    batch: [],
+    grants: [],
+    current_reconciles: {},
+    auto_contribute: true,
+    rewards_enabled: true
+  })
+}
+
+// Sessions of the background pages of extensions, e.g. Brave Rewards.
+const attachExtensions = async (devtools) => {
+  const sessions = {}
+  const { targetInfos } = await devtools.send('Target.getTargets')
+  for (const target of targetInfos.filter((info) => info.type === 'background_page')) {
+    const { sessionId } = await devtools.send('Target.attachToTarget', { targetId: target.targetId, flatten: true })
+    sessions[`extension ${target.title || target.url}`] = sessionId
+  }
+  return sessions
+}
+
+const takeHeapSnapshot = async (devtools, sessionId, file) => {
+  const fd = fs.openSync(file, 'w')
+  const onChunk = (params, eventSessionId) => {
+    if (eventSessionId === sessionId) {
+      fs.writeSync(fd, params.chunk)
+    }
+  }
+  devtools.on('HeapProfiler.addHeapSnapshotChunk', onChunk)
+  try {
+    await devtools.send('HeapProfiler.takeHeapSnapshot', { reportProgress: false }, sessionId, heapSnapshotTimeoutMs)
+  } finally {
+    devtools.removeListener('HeapProfiler.addHeapSnapshotChunk', onChunk)
+    fs.closeSync(fd)
+  }
+}
+
+// Writes a heap snapshot of every session in |sessions| to |outputDir|,
+// named after the session and |label|.
+const takeHeapSnapshots = async (devtools, sessions, outputDir, label) => {
+  const files = []
+  for (const [name, sessionId] of Object.entries(sessions)) {
+    const file = path.join(outputDir, `${name.replace(/[^\w.-]+/g, '_')}.${label}.heapsnapshot`)
+    try {
+      await takeHeapSnapshot(devtools, sessionId, file)
+      files.push(file)
+    } catch (e) {
+      console.log(`Could not take a heap snapshot of ${name}: ${e.message}`)
+    }
+  }
+  return files
+}
+
+// Memory, open handles and V8 heap of |sessions| at |hours| into the soak.
+const takeSample = async (devtools, pid, sessions, hours) => {
+  const v8Heap = {}
+  for (const [name, sessionId] of Object.entries(sessions)) {
+    try {
+      const { usedSize } = await devtools.send('Runtime.getHeapUsage', {}, sessionId)
+      v8Heap[name] = usedSize / (1024 * 1024)
+    } catch (e) {
+      v8Heap[name] = null
+    }
+  }
+  return { hours, memory: sampleMemory(pid), v8_heap_mb: v8Heap }
+}
+
+const sumOver = (memory, field) => Object.values(memory).reduce((sum, type) => sum + type[field], 0)
+
+// Growth per hour of every sampled value after the warmup, from a least
+// squares fit.
+const growthReport = (samples, totalHours) => {
+  const warmupHours = Math.min(maxWarmupHours, totalHours / 4)
+  const steady = samples.filter((sample) => sample.hours >= warmupHours)
+  const slope = (valueOf) => {
+    const points = steady.map((sample) => [sample.hours, valueOf(sample)]).filter(([, value]) => typeof value === 'number')
+    const fit = linearRegression(points)
+    return fit ? fit.slope : null
+  }
+  const types = new Set([].concat(...steady.map((sample) => Object.keys(sample.memory))))
+  const names = new Set([].concat(...steady.map((sample) => Object.keys(sample.v8_heap_mb))))
+  const byProcessType = {}
+  for (const type of types) {
+    const field = (name) => (sample) => sample.memory[type] ? sample.memory[type][name] : 0
+    byProcessType[type] = {
+      rss_mb_per_hour: slope(field('rss')),
+      private_mb_per_hour: slope(field('private')),
+      handles_per_hour: slope(field('handles'))
+    }
+  }
+  const v8Heap = {}
+  for (const name of names) {
+    v8Heap[name] = slope((sample) => sample.v8_heap_mb[name])
+  }
+  return {
+    warmup_hours: warmupHours,
+    samples: steady.length,
+    total_rss_mb_per_hour: slope((sample) => sumOver(sample.memory, 'rss')),
+    total_private_mb_per_hour: slope((sample) => sumOver(sample.memory, 'private')),
+    total_handles_per_hour: slope((sample) => sumOver(sample.memory, 'handles')),
+    by_process_type: byProcessType,
+    v8_heap_mb_per_hour: v8Heap
+  }
+}
+
+// Keeps the browser busy for |hours|: tabs which stay open are navigated
+// and other tabs are opened and closed every cycle, against a replay server
+// of the corpus in |options.corpus| or of synthetic pages, with rewards and
+// ads running against stand-ins of their staging servers. Samples memory,
+// handles and V8 heaps every |options.sampleIntervalMs| and takes heap
+// snapshots at the start and the end. Writes soak-report.json and the
+// snapshots to |options.outputDir|. Resolves to 1 if the browser crashed, or
+// its private memory grew faster than |options.maxGrowthMbPerHour| or its
+// handles faster than |maxHandleGrowthPerHour| after the warmup. Linux only.
+const soakTest = async (binary, args, hours, options) => {
+  if (process.platform !== 'linux') {
+    throw new Error('The soak test is only supported on Linux')
+  }
+  fs.emptyDirSync(options.outputDir)
+  const runDir = fs.mkdtempSync(path.join(os.tmpdir(), 'brave-soak-'))
+  const userDataDir = path.join(runDir, 'profile')
+  if (options.profile) {
+    fs.copySync(options.profile, userDataDir)
+  }
+  writePreferences(userDataDir, soakPreferences)
+  seedRewardsWallet(path.join(userDataDir, 'Default'), Date.now())
+
+  const samples = []
+  let heapSnapshots = []
+  let cycles = 0
+  let failedLoads = 0
+  let crashed = false
+  const startTime = Date.now()
+  const elapsedHours = () => (Date.now() - startTime) / 3600000
+  let replay
+  try {
+    replay = await withReplayServer(options.corpus, async (server) => {
+      const pages = server.archive.pages
+      const soakArgs = args.concat(server.browserArgs(), ['--remote-debugging-pipe', '--user-data-dir=' + userDataDir])
+      await withBenchmarkEnvironment(soakArgs, async (benchArgs, env) => {
+        const browser = new BrowserProcess(binary, benchArgs, { env, stdio: DevToolsPipe.pipeStdio })
+        const devtools = new DevToolsPipe(browser)
+        try {
+          await devtools.send('Browser.getVersion')
+          await sleep(startupSettleMs)
+          const tabs = []
+          for (let i = 0; i < persistentTabs; i++) {
+            tabs.push(await openTab(devtools, pages[i % pages.length]))
+          }
+          const sessions = await attachExtensions(devtools)
+          tabs.forEach((tab, i) => { sessions[`tab ${i}`] = tab.sessionId })
+          heapSnapshots = heapSnapshots.concat(await takeHeapSnapshots(devtools, sessions, options.outputDir, 'start'))
+
+          let nextSample = Date.now()
+          while (elapsedHours() < hours && !browser.exited) {
+            if (Date.now() >= nextSample) {
+              samples.push(await takeSample(devtools, browser.pid, sessions, elapsedHours()))
+              nextSample += options.sampleIntervalMs
+            }
+            for (let i = 0; i < tabs.length; i++) {
+              if (!await navigate(devtools, tabs[i].sessionId, pages[(cycles + i + 1) % pages.length])) {
+                failedLoads++
+              }
+            }
+            for (let i = 0; i < cycleTabs; i++) {
+              const tab = await openTab(devtools, pages[(cycles * cycleTabs + i) % pages.length])
+              failedLoads += tab.loaded ? 0 : 1
+              await sleep(tabDwellMs)
+              await devtools.send('Target.closeTarget', { targetId: tab.targetId })
+            }
+            cycles++
+            await sleep(cycleIdleMs)
+          }
+          if (browser.exited) {
+            crashed = true
+          } else {
+            samples.push(await takeSample(devtools, browser.pid, sessions, elapsedHours()))
+            heapSnapshots = heapSnapshots.concat(await takeHeapSnapshots(devtools, sessions, options.outputDir, 'end'))
+          }
+        } catch (e) {
+          // The pipe closes when the browser crashes, usually before its exit
+          // is seen.
+          if (!await browser.waitForExit(crashExitTimeoutMs)) {
+            throw e
+          }
+          crashed = true
+        } finally {
+          await devtools.send('Browser.close', {}, undefined, 5000).catch(() => {})
+          await browser.stop()
+        }
+      })
+      return server.stats()
+    }, { standIns: stagingStandIns })
+  } finally {
+    fs.removeSync(runDir)
+  }
+
+  const growth = growthReport(samples, hours)
+  const failures = []
+  if (crashed) {
+    failures.push(`Brave exited after ${elapsedHours().toFixed(2)}h`)
+  }
+  if (growth.total_private_mb_per_hour > options.maxGrowthMbPerHour) {
+    failures.push(`private memory grew by ${growth.total_private_mb_per_hour}MB/h, more than ${options.maxGrowthMbPerHour}MB/h`)
+  }
+  if (growth.total_handles_per_hour > maxHandleGrowthPerHour) {
+    failures.push(`open handles grew by ${growth.total_handles_per_hour}/h, more than ${maxHandleGrowthPerHour}/h`)
+  }
+  const report = {
+    binary,
+    hours: Math.round(elapsedHours() * 100) / 100,
+    cycles,
+    failed_loads: failedLoads,
+    max_growth_mb_per_hour: options.maxGrowthMbPerHour,
+    passed: !failures.length,
+    failures,
+    growth,
+    heap_snapshots: heapSnapshots,
+    replay,
+    samples
+  }
+  const reportFile = path.join(options.outputDir, 'soak-report.json')
+  fs.writeJsonSync(reportFile, report, { spaces: 2 })
+
+  console.log(`soak ran ${report.hours}h, ${cycles} cycles, ${failedLoads} failed page loads, ` +
+    `${report.replay.stoodIn} Rewards and ads requests answered`)
+  console.log(`growth after ${growth.warmup_hours}h of warmup: private ${growth.total_private_mb_per_hour}MB/h, ` +
+    `RSS ${growth.total_rss_mb_per_hour}MB/h, handles ${growth.total_handles_per_hour}/h`)
+  for (const [type, typeGrowth] of Object.entries(growth.by_process_type)) {
+    console.log(`  ${type}: private ${typeGrowth.private_mb_per_hour}MB/h, handles ${typeGrowth.handles_per_hour}/h`)
+  }
+  for (const [name, slope] of Object.entries(growth.v8_heap_mb_per_hour)) {
+    console.log(`  V8 heap of ${name}: ${slope}MB/h`)
+  }
+  failures.forEach((failure) => console.log('SOAK FAIL: ' + failure))
+  console.log(`soak report and heap snapshots written to ${options.outputDir}`)
+  return report.passed ? 0 : 1
+}
+
+module.exports = soakTest
+module.exports.growthReport = growthReport
@@ -0,0 +1,38 @@
+const { growthReport } = require('./soakTest')
+
+const sample = (hours, browserPrivate, rendererPrivate, handles, heap) => ({
+  hours,
+  memory: {
+    browser: { count: 1, rss: browserPrivate + 50, private: browserPrivate, handles },
+    renderer: { count: 2, rss: rendererPrivate + 20, private: rendererPrivate, handles: 100 }
+  },
+  v8_heap_mb: { 'tab 0': heap }
+})
+
+test('fits the growth per hour after the warmup', function () {
+  // The first sample is taken while caches fill up and is left out.
+  const samples = [
+    sample(0, 10, 40, 100, 1),
+    sample(1, 200, 80, 200, 5),
+    sample(2, 210, 80, 205, 7),
+    sample(3, 220, 80, 210, null),
+    sample(4, 230, 80, 215, 11)
+  ]
+  const growth = growthReport(samples, 4)
+  expect(growth.warmup_hours).toBe(1)
+  expect(growth.samples).toBe(4)
+  expect(growth.total_private_mb_per_hour).toBe(10)
+  expect(growth.total_rss_mb_per_hour).toBe(10)
+  expect(growth.total_handles_per_hour).toBe(5)
+  expect(growth.by_process_type.browser.private_mb_per_hour).toBe(10)
+  expect(growth.by_process_type.renderer.private_mb_per_hour).toBe(0)
+  // Sessions which could not report their heap are skipped.
+  expect(growth.v8_heap_mb_per_hour['tab 0']).toBe(2)
+})
+
+test('warms up for a quarter of short soaks and needs two samples', function () {
+  expect(growthReport([sample(0.25, 10, 10, 10, 1), sample(0.5, 12, 10, 10, 1)], 2).warmup_hours).toBe(0.5)
+  const growth = growthReport([sample(0.25, 10, 10, 10, 1), sample(0.5, 12, 10, 10, 1)], 2)
+  expect(growth.samples).toBe(1)
+  expect(growth.total_private_mb_per_hour).toBe(null)
+})
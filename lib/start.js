@@ -1,25 +1,21 @@
 const path = require('path')
 const fs = require('fs-extra')
-const ip = require('ip')
-const URL = require('url').URL
 const config = require('../lib/config')
 const util = require('../lib/util')
-const whitelistedUrlPrefixes = require('./whitelistedUrlPrefixes')
-const whitelistedUrlPatterns = require('./whitelistedUrlPatterns')
-const whitelistedUrlProtocols = [
-  'chrome-extension:',
-  'chrome:',
-  'brave:',
-  'file:',
-  'data:',
-  'blob:'
-]
+const networkAudit = require('./networkAudit')
+const networkAuditScenarios = require('./networkAuditScenarios')
+const startupBenchmark = require('./startupBenchmark')
+const componentBenchmark = require('./componentBenchmark')
+const pageLoadBenchmark = require('./pageLoadBenchmark')
+const soakTest = require('./soakTest')
+const cpuProfile = require('./cpuProfile')
+const heapProfile = require('./heapProfile')
+const { writePreferences } = require('./benchmarkProfile')
 
-const start = (passthroughArgs, buildConfig = config.defaultBuildConfig, options) => {
-  config.buildConfig = buildConfig
-  config.update(options)
+const networkAuditTimeoutMs = 120000
 
-  let braveArgs = [
+const getBraveArgs = (options) => {
+  const braveArgs = [
     '--enable-logging',
     '--v=' + options.v,
   ]
@@ -72,19 +68,204 @@ const start = (passthroughArgs, buildConfig = config.defaultBuildConfig, options
   if (options.brave_ads_staging) {
     braveArgs.push('--brave-ads-staging')
   }
-  braveArgs = braveArgs.concat(passthroughArgs)
+  return braveArgs
+}
 
-  let user_data_dir
-  if (options.user_data_dir_name) {
+const getUserDataDir = (userDataDirName) => {
+  if (process.platform === 'darwin') {
+    return path.join(process.env.HOME, 'Library', 'Application\\ Support', 'BraveSoftware', userDataDirName)
+  } else if (process.platform === 'win32') {
+    return path.join(process.env.LocalAppData, 'BraveSoftware', userDataDirName)
+  } else {
+    return path.join(process.env.HOME, '.config', 'BraveSoftware', userDataDirName)
+  }
+}
+
+const getOutputPath = (options) => {
+  let outputPath = options.output_path
+  if (!outputPath) {
     if (process.platform === 'darwin') {
-      user_data_dir = path.join(process.env.HOME, 'Library', 'Application\\ Support', 'BraveSoftware', options.user_data_dir_name)
+      let outputDir = config.outputDir
+      if (config.shouldSign()) {
+        outputDir = path.join(outputDir, config.mac_signing_output_prefix)
+      }
+      outputPath = path.join(outputDir,
+                             'Brave\\ Browser\\ Development.app', 'Contents', 'MacOS',
+                             'Brave\\ Browser\\ Development')
     } else if (process.platform === 'win32') {
-      user_data_dir = path.join(process.env.LocalAppData, 'BraveSoftware', options.user_data_dir_name)
+      outputPath = path.join(config.outputDir, 'brave.exe')
     } else {
-      user_data_dir = path.join(process.env.HOME, '.config', 'BraveSoftware', options.user_data_dir_name)
+      outputPath = path.join(config.outputDir, 'brave')
+    }
+  }
+  return outputPath
+}
+
+// The network audit does not run the browser through a shell, so the escaping
+// of spaces needed for the shell on macOS is undone.
+const unescapeShellArg = (arg) => process.platform === 'darwin' ? arg.replace(/\\ /g, ' ') : arg
+
+const getNetworkAuditOptions = (options) => ({
+  timeoutMs: networkAuditTimeoutMs,
+  warmupMs: parseInt(options.network_log_warmup, 10) * 1000,
+  quietPeriodMs: parseInt(options.network_log_quiet_period, 10) * 1000
+})
+
+// Runs the network audit once per scenario of --scenarios, concurrently and
+// each with a fresh user data dir and its own NetLog, then merges the
+// outcomes into network-audit-report.json.
+const runNetworkAuditScenarios = async (passthroughArgs, options) => {
+  const names = options.scenarios === 'all'
+    ? Object.keys(networkAuditScenarios)
+    : options.scenarios.split(',').filter((name) => name)
+  const unknown = names.filter((name) => !networkAuditScenarios[name])
+  if (unknown.length) {
+    console.error(`Unknown network audit scenarios ${unknown.join(', ')}. Available scenarios: ${Object.keys(networkAuditScenarios).join(', ')}`)
+    process.exit(1)
+  }
+
+  const rootDir = path.resolve(__dirname, '..')
+  const outputPath = unescapeShellArg(getOutputPath(options))
+  const userDataDirName = options.user_data_dir_name || 'brave-network-test'
+  console.log(`Network audit of scenarios ${names.join(', ')} started...`)
+  const scenarios = await Promise.all(names.map(async (name) => {
+    const { preferences, ...toggles } = networkAuditScenarios[name]
+    const scenarioOptions = Object.assign(Object.create(options), toggles)
+    const userDataDir = unescapeShellArg(getUserDataDir(`${userDataDirName}-${name}`))
+    const networkLogFile = path.join(rootDir, `network_log.${name}.json`)
+    const resultsFile = `network-audit-results.${name}.json`
+    fs.removeSync(userDataDir)
+    if (preferences) {
+      writePreferences(userDataDir, preferences)
+    }
+    const braveArgs = getBraveArgs(scenarioOptions).concat(passthroughArgs).map(unescapeShellArg)
+    braveArgs.push('--user-data-dir=' + userDataDir)
+    braveArgs.push(`--log-net-log=${networkLogFile}`)
+    braveArgs.push('--net-log-capture-mode=Everything')
+    const exitCode = await networkAudit.runNetworkAudit(outputPath, braveArgs, networkLogFile, resultsFile,
+      Object.assign({ label: name }, getNetworkAuditOptions(options)))
+    return { name, passed: exitCode === 0, args: braveArgs, networkLog: networkLogFile, results: path.resolve(resultsFile) }
+  }))
+
+  const passed = scenarios.every((scenario) => scenario.passed)
+  fs.writeJsonSync('network-audit-report.json', { passed, scenarios }, { spaces: 2 })
+  for (const scenario of scenarios) {
+    console.log(`${scenario.name}: ${scenario.passed ? 'passed' : `failed, import ${scenario.networkLog} in chrome://net-internals for more details`}`)
+  }
+  console.log(passed ? 'network audit passed.' : 'network-audit failed.')
+  process.exit(passed ? 0 : 1)
+}
+
+const start = (passthroughArgs, buildConfig = config.defaultBuildConfig, options) => {
+  config.buildConfig = buildConfig
+  config.update(options)
+
+  if (options.bench_startup) {
+    return startupBenchmark(unescapeShellArg(getOutputPath(options)),
+      getBraveArgs(options).concat(passthroughArgs).map(unescapeShellArg),
+      parseInt(options.bench_startup, 10), {
+        profile: options.bench_profile,
+        output: options.bench_output || 'startup-benchmark.json'
+      })
+  }
+
+  if (options.bench_components) {
+    const argsFor = (toggles) => getBraveArgs(Object.assign(Object.create(options), toggles))
+      .concat(passthroughArgs).map(unescapeShellArg)
+    return componentBenchmark(unescapeShellArg(getOutputPath(options)), argsFor,
+      parseInt(options.bench_components, 10), {
+        matrix: options.component_matrix || 'one_at_a_time',
+        settleSeconds: parseInt(options.settle_seconds || 15, 10),
+        profile: options.bench_profile,
+        output: options.bench_output || 'component-benchmark.json'
+      })
+  }
+
+  if (options.bench_page_load || options.record_corpus) {
+    if (!options.page_corpus) {
+      console.error('--bench_page_load and --record_corpus need a --page_corpus directory')
+      process.exit(1)
+    }
+    const binary = unescapeShellArg(getOutputPath(options))
+    const braveArgs = getBraveArgs(options).concat(passthroughArgs).map(unescapeShellArg)
+    if (options.record_corpus) {
+      return pageLoadBenchmark.recordCorpus(binary, braveArgs, {
+        corpus: options.page_corpus,
+        profile: options.bench_profile
+      })
     }
+    return pageLoadBenchmark(binary, braveArgs, parseInt(options.bench_page_load, 10), {
+      corpus: options.page_corpus,
+      profile: options.bench_profile,
+      output: options.bench_output || 'page-load-benchmark.json'
+    })
+  }
+
+  if (options.soak) {
+    // Rewards and ads talk to staging rather than production servers, were
+    // anything to get past the replay server.
+    const soakOptions = Object.assign(Object.create(options), {
+      rewards: options.rewards || 'staging=true',
+      brave_ads_staging: true
+    })
+    return soakTest(unescapeShellArg(getOutputPath(options)),
+      getBraveArgs(soakOptions).concat(passthroughArgs).map(unescapeShellArg),
+      parseFloat(options.soak), {
+        corpus: options.page_corpus,
+        profile: options.bench_profile,
+        sampleIntervalMs: parseFloat(options.soak_sample_interval) * 60000,
+        maxGrowthMbPerHour: parseFloat(options.soak_max_growth),
+        outputDir: 'soak_results'
+      }).then((exitCode) => process.exit(exitCode), (e) => {
+        console.error(e.message)
+        process.exit(1)
+      })
+  }
+
+  if (options.profile_heap) {
+    return heapProfile(unescapeShellArg(getOutputPath(options)),
+      getBraveArgs(options).concat(passthroughArgs).map(unescapeShellArg), {
+        corpus: options.page_corpus,
+        profile: options.bench_profile,
+        samplingBytes: parseInt(options.heap_sampling_rate, 10),
+        buildArgs: config.buildArgs(),
+        srcDir: config.srcDir,
+        outDir: config.outputDir,
+        outputDir: 'heap_profile'
+      }).catch((e) => {
+        console.error(e.message)
+        process.exit(1)
+      })
+  }
+
+  if (options.network_log && options.scenarios) {
+    return runNetworkAuditScenarios(passthroughArgs, options)
+  }
+
+  let braveArgs = getBraveArgs(options).concat(passthroughArgs)
+
+  let user_data_dir
+  if (options.user_data_dir_name) {
+    user_data_dir = getUserDataDir(options.user_data_dir_name)
     braveArgs.push('--user-data-dir=' + user_data_dir);
   }
+  if (options.profile_cpu) {
+    // perf only sees the processes of the sandbox by their pids outside of
+    // its namespaces, and V8 can only write its perf map of JIT code to /tmp
+    // without it.
+    if (!options.no_sandbox) {
+      braveArgs.push('--no-sandbox')
+    }
+    braveArgs.push('--js-flags=--perf-basic-prof')
+    return cpuProfile(unescapeShellArg(getOutputPath(options)), braveArgs.map(unescapeShellArg), {
+      buildArgs: config.buildArgs(),
+      outputDir: 'cpu_profile'
+    }).catch((e) => {
+      console.error(e.message)
+      process.exit(1)
+    })
+  }
+
   const networkLogFile = path.resolve(path.join(__dirname, '..', 'network_log.json'))
   if (options.network_log) {
     braveArgs.push(`--log-net-log=${networkLogFile}`)
@@ -103,102 +284,27 @@ const start = (passthroughArgs, buildConfig = config.defaultBuildConfig, options
 
   let cmdOptions = {
     stdio: 'inherit',
-    timeout: options.network_log ? 120000 : undefined,
-    continueOnFail: options.network_log ? true : false,
-    shell: process.platform === 'darwin' ? true : false,
-    killSignal: options.network_log && process.env.RELEASE_TYPE ? 'SIGKILL' : 'SIGTERM'
+    shell: process.platform === 'darwin' ? true : false
   }
 
+  const outputPath = getOutputPath(options)
   if (options.network_log) {
-    console.log('Network audit started. Logging requests for the next 2min or until you quit Brave...')
-  }
-
-  let outputPath = options.output_path
-  if (!outputPath) {
-    if (process.platform === 'darwin') {
-      let outputDir = config.outputDir
-      if (config.shouldSign()) {
-        outputDir = path.join(outputDir, config.mac_signing_output_prefix)
+    const auditOptions = getNetworkAuditOptions(options)
+    console.log(`Network audit started. Logging requests until there are no new ones for ${auditOptions.quietPeriodMs / 1000}s, for at most 2min or until you quit Brave...`)
+    return networkAudit.runNetworkAudit(unescapeShellArg(outputPath), braveArgs.map(unescapeShellArg), networkLogFile,
+      'network-audit-results.json', auditOptions).then((exitCode) => {
+      if (exitCode > 0) {
+        console.log(`network-audit failed. import ${networkLogFile} in chrome://net-internals for more details.`)
+      } else {
+        console.log('network audit passed.')
       }
-      outputPath = path.join(outputDir,
-                             'Brave\\ Browser\\ Development.app', 'Contents', 'MacOS',
-                             'Brave\\ Browser\\ Development')
-    } else if (process.platform === 'win32') {
-      outputPath = path.join(config.outputDir, 'brave.exe')
-    } else {
-      outputPath = path.join(config.outputDir, 'brave')
-    }
-  }
-  util.run(outputPath, braveArgs, cmdOptions)
-
-  if (options.network_log) {
-    let exitCode = 0
-    let jsonOutput = {}
-    // Read the network log
-    let jsonContent = fs.readFileSync(networkLogFile, 'utf8').trim()
-    // On windows netlog ends abruptly causing JSON parsing errors
-    if (!jsonContent.endsWith('}]}')) {
-      const n = jsonContent.lastIndexOf('},')
-      jsonContent = jsonContent.substring(0, n) + '}]}'
-    }
-    jsonOutput = JSON.parse(jsonContent)
-
-    const URL_REQUEST_TYPE = jsonOutput.constants.logSourceType.URL_REQUEST
-    const URL_REQUEST_FAKE_RESPONSE_HEADERS_CREATED = jsonOutput.constants.logEventTypes.URL_REQUEST_FAKE_RESPONSE_HEADERS_CREATED
-    const urlRequests = jsonOutput.events.filter((event) => {
-      if (event.type === URL_REQUEST_FAKE_RESPONSE_HEADERS_CREATED) {
-        // showing these helps determine which URL requests which don't
-        // actually hit the network
-        return true
-      }
-      if (event.source.type === URL_REQUEST_TYPE) {
-        if (!event.params) {
-          return false
-        }
-        const url = event.params.url
-        if (!url) {
-          return false
-        }
-        const urlParsed = new URL(url)
-        const hostname = urlParsed.hostname
-        if (/^[a-z]+$/.test(hostname)) {
-          // Chromium sometimes sends requests to random non-resolvable hosts
-          return false
-        }
-        if (whitelistedUrlProtocols.includes(urlParsed.protocol)) {
-          return false
-        }
-        const foundPrefix = whitelistedUrlPrefixes.find((prefix) => {
-          return url.startsWith(prefix)
-        })
-        const foundPattern = whitelistedUrlPatterns.find((pattern) => {
-          return RegExp('^' + pattern).test(url)
-        })
-        if (!foundPrefix && !foundPattern) {
-          // Check if the URL is a private IP
-          try {
-            if (ip.isPrivate(hostname)) {
-              // Warn but don't fail the audit
-              console.log('NETWORK AUDIT WARN:', url)
-              return true
-            }
-          } catch (e) {}
-          // This is not a whitelisted URL! log it and exit with non-zero
-          console.log('NETWORK AUDIT FAIL:', url)
-          exitCode = 1
-        }
-        return true
-      }
-      return false
+      process.exit(exitCode)
     })
-    fs.writeJsonSync('network-audit-results.json', urlRequests)
-    if (exitCode > 0) {
-      console.log(`network-audit failed. import ${networkLogFile} in chrome://net-internals for more details.`)
-    } else {
-      console.log('network audit passed.')
-    }
-    process.exit(exitCode)
   }
+  util.run(outputPath, braveArgs, cmdOptions)
 }
 
 module.exports = start
+module.exports.getUserDataDir = getUserDataDir
+module.exports.getOutputPath = getOutputPath
+module.exports.unescapeShellArg = unescapeShellArg
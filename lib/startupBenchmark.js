@@ -0,0 +1,212 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const os = require('os')
+const fs = require('fs-extra')
+const { spawnSync } = require('child_process')
+const BrowserProcess = require('./browserProcess')
+const DisplayPool = require('./displayPool')
+const { summarize } = require('./benchmarkStats')
+
+const traceCategories = 'startup,browser,toplevel,loading,extensions'
+// The startup trace is written once this much time has passed.
+const traceDurationSeconds = 10
+const traceTimeoutMs = 60000
+
+// Durations in ms of the phases of a startup, from a startup trace.
+const startupMetrics = {
+  // Async events recorded by startup_metric_utils, starting at process
+  // creation.
+  first_paint: (events) => asyncDuration(events, /^Startup\.FirstWebContents\.NonEmptyPaint/),
+  browser_main_init: (events) => totalDuration(events, 'BrowserMainRunnerImpl::Initialize'),
+  extension_load: (events) => totalDuration(events, 'ExtensionService::Init')
+}
+
+// Total duration of the complete ('X') and begin/end ('B'/'E') events named
+// |name|, in ms.
+const totalDuration = (events, name) => {
+  let total = 0
+  let found = false
+  const open = new Map()
+  for (const event of events) {
+    if (event.name !== name) {
+      continue
+    }
+    const thread = `${event.pid}:${event.tid}`
+    if (event.ph === 'X') {
+      total += event.dur || 0
+      found = true
+    } else if (event.ph === 'B') {
+      open.set(thread, (open.get(thread) || []).concat(event.ts))
+    } else if (event.ph === 'E' && open.has(thread) && open.get(thread).length) {
+      total += event.ts - open.get(thread).pop()
+      found = true
+    }
+  }
+  return found ? total / 1000 : null
+}
+
+// Duration of the first async event whose name matches |nameRegex|, in ms.
+const asyncDuration = (events, nameRegex) => {
+  const begins = new Map()
+  for (const event of events) {
+    if (!nameRegex.test(event.name || '')) {
+      continue
+    }
+    const key = `${event.name}:${event.id}`
+    if (event.ph === 'b' || event.ph === 'S') {
+      begins.set(key, event.ts)
+    } else if ((event.ph === 'e' || event.ph === 'F') && begins.has(key)) {
+      return (event.ts - begins.get(key)) / 1000
+    }
+  }
+  return null
+}
+
+const readTrace = (traceFile) => {
+  try {
+    const trace = fs.readJsonSync(traceFile)
+    return Array.isArray(trace) ? trace : trace.traceEvents
+  } catch (e) {
+    // Not written yet, or still being written.
+    return null
+  }
+}
+
+// Drops the OS page cache so the next launch reads the binary and profile
+// from disk. Needs root, or passwordless sudo.
+const dropPageCache = () => {
+  if (process.platform === 'linux') {
+    spawnSync('sync')
+    try {
+      fs.writeFileSync('/proc/sys/vm/drop_caches', '3')
+      return true
+    } catch (e) {
+      return spawnSync('sudo', ['-n', 'sh', '-c', 'echo 3 > /proc/sys/vm/drop_caches']).status === 0
+    }
+  }
+  if (process.platform === 'darwin') {
+    return spawnSync('sudo', ['-n', 'purge']).status === 0
+  }
+  return false
+}
+
+// Launches the browser once with a startup trace and returns its metrics.
+// The user data dir is fresh, or a copy of |seedProfile|. |beforeLaunch| is
+// called once the profile is in place, e.g. to drop the OS caches after the
+// copy put it in them. |whileRunning| is called with the browser once the
+// trace was written, before it is quit.
+const measureStartup = async (binary, args, seedProfile, env, whileRunning, beforeLaunch) => {
+  const runDir = fs.mkdtempSync(path.join(os.tmpdir(), 'brave-startup-'))
+  const userDataDir = path.join(runDir, 'profile')
+  const traceFile = path.join(runDir, 'trace.json')
+  if (seedProfile) {
+    fs.copySync(seedProfile, userDataDir)
+  }
+  if (beforeLaunch) {
+    beforeLaunch()
+  }
+  const browser = new BrowserProcess(binary, args.concat([
+    '--user-data-dir=' + userDataDir,
+    '--trace-startup=' + traceCategories,
+    '--trace-startup-file=' + traceFile,
+    '--trace-startup-duration=' + traceDurationSeconds
+  ]), { env, stdio: 'ignore' })
+  let events = null
+  try {
+    const deadline = Date.now() + traceTimeoutMs
+    while (!browser.exited && Date.now() < deadline && !(events = readTrace(traceFile))) {
+      await BrowserProcess.sleep(BrowserProcess.pollIntervalMs)
+    }
+    if (events && whileRunning && !browser.exited) {
+      await whileRunning(browser)
+    }
+    await browser.stop()
+    events = events || readTrace(traceFile)
+  } finally {
+    fs.removeSync(runDir)
+  }
+  if (!events) {
+    console.log('Brave did not write a startup trace')
+    return null
+  }
+  const metrics = {}
+  for (const metric in startupMetrics) {
+    metrics[metric] = startupMetrics[metric](events)
+  }
+  return metrics
+}
+
+// Calls |fn| with the launch arguments and environment benchmarks run the
+// browser with: no first run UI and, on Linux, a virtual display and no GPU.
+const withBenchmarkEnvironment = async (args, fn) => {
+  const benchArgs = args.concat(['--no-first-run', '--no-default-browser-check'])
+  if (process.platform !== 'linux') {
+    return fn(benchArgs, process.env)
+  }
+  benchArgs.push('--disable-gpu', '--password-store=basic')
+  const displayPool = new DisplayPool('xvfb', 1)
+  try {
+    await displayPool.start()
+    return await fn(benchArgs, displayPool.slotOptions(0, process.env).env)
+  } finally {
+    displayPool.stop()
+  }
+}
+
+// Launches |binary| |runs| times with cold and then warm OS caches and
+// writes percentiles of the startup metrics to |options.output|.
+const startupBenchmark = async (binary, args, runs, options) => {
+  const report = {
+    binary,
+    runs,
+    profile: options.profile || 'fresh',
+    traceCategories,
+    modes: {}
+  }
+  await withBenchmarkEnvironment(args, async (benchArgs, env) => {
+    for (const mode of ['cold', 'warm']) {
+      const samples = {}
+      Object.keys(startupMetrics).forEach((metric) => { samples[metric] = [] })
+      if (mode === 'warm') {
+        // Untimed launch which brings the binary and profile into the caches.
+        await measureStartup(binary, benchArgs, options.profile, env)
+      }
+      let coldCaches = mode === 'cold'
+      const dropCaches = () => {
+        if (coldCaches && !dropPageCache()) {
+          console.log('Cannot drop the OS page cache (needs root or passwordless sudo), cold runs only use a fresh process')
+          coldCaches = false
+        }
+      }
+      for (let run = 1; run <= runs; run++) {
+        const metrics = await measureStartup(binary, benchArgs, options.profile, env, null, dropCaches)
+        console.log(`${mode} run ${run}/${runs}: ${JSON.stringify(metrics)}`)
+        if (metrics) {
+          Object.keys(metrics).forEach((metric) => samples[metric].push(metrics[metric]))
+        }
+      }
+      report.modes[mode] = { pageCacheDropped: coldCaches, metrics: {} }
+      for (const metric in samples) {
+        report.modes[mode].metrics[metric] = summarize(samples[metric])
+      }
+    }
+  })
+
+  fs.writeJsonSync(options.output, report, { spaces: 2 })
+  for (const mode in report.modes) {
+    for (const [metric, summary] of Object.entries(report.modes[mode].metrics)) {
+      console.log(`${mode} ${metric}: p50 ${summary.p50}ms, p90 ${summary.p90}ms, p95 ${summary.p95}ms (${summary.samples} samples)`)
+    }
+  }
+  console.log(`startup benchmark written to ${options.output}`)
+  return report
+}
+
+module.exports = startupBenchmark
+module.exports.measureStartup = measureStartup
+module.exports.startupMetrics = startupMetrics
+module.exports.withBenchmarkEnvironment = withBenchmarkEnvironment
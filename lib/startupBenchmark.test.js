@@ -0,0 +1,24 @@
+const { startupMetrics } = require('./startupBenchmark')
+const { summarize } = require('./benchmarkStats')
+
+test('extracts startup phases from a trace', function () {
+  const events = [
+    { name: 'Startup.FirstWebContents.NonEmptyPaint3', ph: 'b', id: '0x1', ts: 1000, pid: 1, tid: 1 },
+    { name: 'BrowserMainRunnerImpl::Initialize', ph: 'X', ts: 2000, dur: 150000, pid: 1, tid: 1 },
+    { name: 'ExtensionService::Init', ph: 'B', ts: 5000, pid: 1, tid: 1 },
+    { name: 'ExtensionService::Init', ph: 'E', ts: 45000, pid: 1, tid: 1 },
+    { name: 'Startup.FirstWebContents.NonEmptyPaint3', ph: 'e', id: '0x1', ts: 801000, pid: 1, tid: 1 }
+  ]
+  expect(startupMetrics.first_paint(events)).toBe(800)
+  expect(startupMetrics.browser_main_init(events)).toBe(150)
+  expect(startupMetrics.extension_load(events)).toBe(40)
+  expect(startupMetrics.extension_load([])).toBe(null)
+})
+
+test('summarizes samples with percentiles', function () {
+  const summary = summarize([40, 10, 30, 20, null])
+  expect(summary.samples).toBe(4)
+  expect(summary.p50).toBe(25)
+  expect(summary.p90).toBe(37)
+  expect(summary.max).toBe(40)
+})
@@ -1,12 +1,57 @@
 const path = require('path')
+const os = require('os')
+const fs = require('fs-extra')
 
 const config = require('../lib/config')
 const util = require('../lib/util')
+const affectedTests = require('./affectedTests')
+const testShards = require('./testShards')
+const TestTimings = require('./testTimings')
+const gtestResults = require('./gtestResults')
+const { FlakinessHistory, excludeFromFilter, retryFailures } = require('./testRetries')
+const TestCache = require('./testCache')
+
+// Retries of failed quarantined tests without --retry_failures.
+const quarantineRetries = 2
+
+// Whether the tests are built with Ozone, which headless display pools need.
+// Desktop Linux builds are X11 unless use_ozone is set, through --gn or in
+// the args.gn of the out dir.
+const isOzoneBuild = () => {
+  if (config.buildArgs().use_ozone === true) {
+    return true
+  }
+  const argsFile = path.join(config.outputDir, 'args.gn')
+  return fs.existsSync(argsFile) && /^\s*use_ozone\s*=\s*true\b/m.test(fs.readFileSync(argsFile, 'utf8'))
+}
 
 const test = (suite, buildConfig = config.defaultBuildConfig, options) => {
   config.buildConfig = buildConfig
   config.update(options)
 
+  if (options.display_pool === 'ozone' && !isOzoneBuild()) {
+    console.error('--display_pool ozone needs a build with use_ozone=true, use --display_pool xvfb for X11 builds')
+    process.exit(1)
+  }
+
+  let runSuite = true
+  let run_brave_installer_unitests = suite === 'brave_unit_tests'
+  let suiteFilter = options.filter
+  if (options.affected) {
+    const base = options.base || 'origin/master'
+    const suiteTests = affectedTests(suite, base)
+    if (!suiteTests.affected) {
+      console.log(`${suite} is not affected by changes since ${base}, skipping it`)
+      runSuite = false
+    } else if (suiteTests.filter && !suiteFilter) {
+      console.log(`running the ${suite} tests affected by changes since ${base}: ${suiteTests.filter}`)
+      suiteFilter = suiteTests.filter
+    }
+    if (run_brave_installer_unitests) {
+      run_brave_installer_unitests = affectedTests('brave_installer_unittests', base).affected
+    }
+  }
+
   const braveArgs = [
     '--enable-logging',
     '--v=' + options.v,
@@ -33,14 +78,18 @@ const test = (suite, buildConfig = config.defaultBuildConfig, options) => {
   }
 
   // Build the tests
-  util.run('ninja', ['-C', config.outputDir, suite], config.defaultOptions)
+  if (runSuite) {
+    util.run('ninja', ['-C', config.outputDir, suite], config.defaultOptions)
+  }
 
-  const run_brave_installer_unitests = suite === 'brave_unit_tests'
   if (run_brave_installer_unitests) {
     util.run('ninja', ['-C', config.outputDir, 'brave_installer_unittests'], config.defaultOptions)
   }
 
   if (config.targetOS === 'ios') {
+    if (!runSuite) {
+      return
+    }
     util.run(path.join(config.outputDir, "iossim"), [
       path.join(config.outputDir, `${suite}.app`),
       path.join(config.outputDir, `${suite}.app/PlugIns/${suite}_module.xctest`)
@@ -59,19 +108,141 @@ const test = (suite, buildConfig = config.defaultBuildConfig, options) => {
       installerTestBinary = 'brave_installer_unittests'
     }
 
-    // Run the tests
-    util.run(path.join(config.outputDir, testBinary), braveArgs, config.defaultOptions)
-
-    if (run_brave_installer_unitests) {
+    const runInstallerTests = () => {
       // Replace output file arguments
       if (options.output) {
         braveArgs.splice(braveArgs.indexOf('--gtest_output=xml:' + options.output, 1))
         braveArgs.push('--gtest_output=xml:brave_installer_unittests.xml')
       }
 
-      util.run(path.join(config.outputDir, installerTestBinary), braveArgs, config.defaultOptions)
+      const installerResults = options.output ? path.resolve(config.srcDir, 'brave_installer_unittests.xml') : null
+      return runCached('brave_installer_unittests', path.join(config.outputDir, installerTestBinary), braveArgs, installerResults, options, () => {
+        util.run(path.join(config.outputDir, installerTestBinary), braveArgs, config.defaultOptions)
+        return true
+      })
+    }
+
+    if (!runSuite) {
+      if (run_brave_installer_unitests) {
+        return runInstallerTests()
+      }
+      return
+    }
+
+    // Run the tests
+    const suiteBinary = path.join(config.outputDir, testBinary)
+    const suiteArgs = braveArgs.filter((arg) => !arg.startsWith('--gtest_filter='))
+
+    if (options.display_pool && !options.total_shards) {
+      options.total_shards = Math.max(2, Math.floor(os.cpus().length / 4))
+    }
+    return runSuiteTests(suite, suiteBinary, suiteArgs, suiteFilter, options)
+      .then((passed) => {
+        if (!passed) {
+          process.exit(1)
+        }
+        if (run_brave_installer_unitests) {
+          return runInstallerTests()
+        }
+      })
+  }
+}
+
+// Serves the results of |suite| from the test cache when its binary,
+// runtime_deps and arguments did not change since a passing run. Otherwise
+// runs |runTests|, which resolves to whether the tests passed, and caches a
+// pass. Resolves to whether the tests passed.
+const runCached = async (suite, binary, args, resultsFile, options, runTests) => {
+  const testCache = options.no_test_cache || options.shard_index !== undefined
+    ? null
+    : new TestCache(config.testCacheDir, config.outputDir)
+  const key = testCache && testCache.key(suite, binary, args)
+  if (key && testCache.restore(suite, key, resultsFile)) {
+    console.log(`${suite} is unchanged since a passing run, using its cached results (--no_test_cache to run it)`)
+    return true
+  }
+  const passed = await runTests()
+  if (key && passed && !testCache.store(suite, key, resultsFile)) {
+    console.log(`not caching the results of ${suite}, some of its tests only passed on a retry`)
+  }
+  return passed
+}
+
+// Runs |suite| unless cached, sharded if requested, then retries its failures
+// and runs quarantined flaky tests separately. Resolves to whether the suite
+// passed.
+const runSuiteTests = async (suite, binary, args, filter, options) => {
+  const needsResults = options.total_shards || options.retry_failures || options.quarantine_flaky
+  const output = options.output || (needsResults ? path.join(config.outputDir, `${suite}.xml`) : null)
+  const resultsFile = output && path.resolve(config.srcDir, output)
+  const history = new FlakinessHistory(config.testHistoryDir, suite)
+  // Only the quarantined tests which --filter or --affected selected run.
+  const selected = options.quarantine_flaky && filter ? new Set(testShards.listTests(binary, filter)) : null
+  const quarantined = (options.quarantine_flaky ? history.quarantined() : [])
+    .filter((test) => !selected || selected.has(test))
+  if (quarantined.length) {
+    console.log(`running ${quarantined.length} chronically flaky tests of ${suite} in a separate quarantine shard`)
+  }
+
+  const suiteFilter = excludeFromFilter(filter, quarantined)
+  const cacheArgs = suiteFilter ? args.concat('--gtest_filter=' + suiteFilter) : args
+  let passed = await runCached(suite, binary, cacheArgs, resultsFile, options, async () => {
+    let passed
+    if (options.total_shards) {
+      passed = await testShards.runShards(suite, binary, args, filter, output, quarantined, options)
+    } else {
+      const suiteArgs = args.filter((arg) => !arg.startsWith('--gtest_output='))
+      if (suiteFilter) {
+        suiteArgs.push('--gtest_filter=' + suiteFilter)
+      }
+      if (resultsFile) {
+        suiteArgs.push('--gtest_output=xml:' + resultsFile)
+      }
+      const prog = util.run(binary, suiteArgs, Object.assign({}, config.defaultOptions, { continueOnFail: true }))
+      if (resultsFile) {
+        new TestTimings(config.testHistoryDir, suite).recordResults(resultsFile)
+      }
+      passed = prog.status === 0
+    }
+
+    const retries = parseInt(options.retry_failures, 10)
+    if (!passed && retries > 0 && resultsFile && fs.existsSync(resultsFile)) {
+      passed = retryFailures(binary, args, resultsFile, retries)
+    }
+    if (resultsFile && fs.existsSync(resultsFile)) {
+      history.record(gtestResults.read(resultsFile))
+    }
+    return passed
+  })
+
+  if (quarantined.length) {
+    // Quarantined results go to their own file. Their flaky failures do not
+    // fail the run, but tests which fail on every retry are broken and do.
+    const quarantineArgs = args.filter((arg) => !arg.startsWith('--gtest_output='))
+    quarantineArgs.push('--gtest_filter=' + quarantined.join(':'))
+    const quarantineFile = resultsFile.replace(/(\.xml)?$/, '.quarantine.xml')
+    quarantineArgs.push('--gtest_output=xml:' + quarantineFile)
+    const prog = util.run(binary, quarantineArgs, Object.assign({}, config.defaultOptions, { continueOnFail: true }))
+    let quarantinePassed = prog.status === 0
+    if (!quarantinePassed && fs.existsSync(quarantineFile)) {
+      quarantinePassed = retryFailures(binary, args, quarantineFile,
+        parseInt(options.retry_failures, 10) || quarantineRetries)
+    }
+    if (fs.existsSync(quarantineFile)) {
+      const results = gtestResults.read(quarantineFile)
+      for (const broken of results.filter(gtestResults.isFailure)) {
+        console.error(`quarantined test ${gtestResults.fullName(broken)} failed on every attempt`)
+      }
+      // Tests which passed on a retry are flaky="true" and stay quarantined,
+      // the others leave the quarantine once they stop flaking.
+      history.record(results)
+    }
+    if (!quarantinePassed) {
+      console.error(`quarantined tests of ${suite} failed on every attempt, see ${quarantineFile}`)
+      passed = false
     }
   }
+  return passed
 }
 
 module.exports = test
@@ -0,0 +1,181 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const crypto = require('crypto')
+const fs = require('fs-extra')
+const config = require('../lib/config')
+const util = require('../lib/util')
+
+// Test bundles hold everything a test suite needs at runtime, so its shards
+// can run on hosts without a checkout. File contents are stored once in a
+// content-addressed objects dir shared by all bundles, so re-syncing a bundle
+// to a host only transfers what changed since the last one:
+//   <out>/test_bundles/objects/<sha256>[-x]
+//   <out>/test_bundles/<suite>-<id>/{manifest.json,files.txt,tests.txt,run_shard.sh}
+// files.txt maps objects to their path relative to src, which is recreated
+// with hard links in a work dir per shard.
+
+const bundlesDirName = 'test_bundles'
+
+// The bundle runner only needs a POSIX shell on the worker.
+const runShardScript = `#!/bin/sh
+# Usage: run_shard.sh <shard index> [test args...]
+# Materializes the bundle into work/<shard index> and runs the tests listed in
+# shards/<shard index>.filter, writing results/<shard index>.xml.
+set -e
+bundle_dir=$(cd "$(dirname "$0")" && pwd)
+objects_dir="$bundle_dir/../objects"
+shard=$1
+shift
+root="$bundle_dir/work/$shard"
+rm -rf "$root"
+while read -r object file; do
+  mkdir -p "$root/$(dirname "$file")"
+  ln "$objects_dir/$object" "$root/$file" 2>/dev/null || cp -p "$objects_dir/$object" "$root/$file"
+done < "$bundle_dir/files.txt"
+mkdir -p "$bundle_dir/results"
+binary=$(cat "$bundle_dir/binary.txt")
+launcher=
+if [ -z "$DISPLAY" ] && command -v xvfb-run > /dev/null; then
+  launcher="xvfb-run -a"
+fi
+status=0
+(cd "$root" && $launcher "./$binary" \\
+  --test-launcher-filter-file="$bundle_dir/shards/$shard.filter" \\
+  --gtest_output=xml:"$bundle_dir/results/$shard.xml" "$@") || status=$?
+rm -rf "$root"
+exit $status
+`
+
+const bundlesDir = (outputDir = config.outputDir) => path.join(outputDir, bundlesDirName)
+
+const hashFile = (file) => {
+  const hash = crypto.createHash('sha256')
+  const fd = fs.openSync(file, 'r')
+  const buffer = Buffer.alloc(1024 * 1024)
+  try {
+    let bytesRead
+    while ((bytesRead = fs.readSync(fd, buffer, 0, buffer.length, null)) > 0) {
+      hash.update(buffer.slice(0, bytesRead))
+    }
+  } finally {
+    fs.closeSync(fd)
+  }
+  return hash.digest('hex')
+}
+
+// Executable files get their own objects, so hard links keep the mode.
+const objectName = (file, stat) =>
+  hashFile(file) + (process.platform !== 'win32' && (stat.mode & 0o111) ? '-x' : '')
+
+// Runs gn with |args|, throwing when it fails so callers can recover.
+const runGn = (args) => {
+  const options = Object.assign({}, config.defaultOptions, { stdio: 'pipe', continueOnFail: true })
+  const prog = util.run('gn', args, options)
+  if (prog.status !== 0) {
+    const output = prog.error ? prog.error.message : (prog.stdout.toString() + prog.stderr.toString()).trim()
+    throw new Error(`gn ${args[0]} failed: ${output}`)
+  }
+  return prog
+}
+
+// Label of the test executable target named |suite|.
+const suiteLabel = (outputDir, suite) => {
+  const prog = runGn(['ls', outputDir, '"//*"', '--type=executable', '--testonly=true', '--as=label'])
+  const label = prog.stdout.toString().split(/\r?\n/)
+    .find((line) => line.split('(')[0].endsWith(':' + suite))
+  if (!label) {
+    throw new Error(`${suite} is not a test executable of ${outputDir}`)
+  }
+  return label.trim()
+}
+
+// Files |label| needs at runtime, relative to src. Directories listed in
+// runtime_deps are expanded.
+const runtimeDeps = (outputDir, label) => {
+  const prog = runGn(['desc', outputDir, label, 'runtime_deps'])
+  const files = new Set()
+  const add = (file) => {
+    const stat = fs.statSync(file)
+    if (stat.isDirectory()) {
+      fs.readdirSync(file).forEach((entry) => add(path.join(file, entry)))
+      return
+    }
+    const relative = path.relative(config.srcDir, file)
+    if (relative.startsWith('..') || path.isAbsolute(relative)) {
+      console.warn(`Skipping runtime dependency outside of src: ${file}`)
+      return
+    }
+    files.add(relative.replace(/\\/g, '/'))
+  }
+  for (const line of prog.stdout.toString().split(/\r?\n/).filter((line) => line)) {
+    const file = path.resolve(outputDir, line)
+    if (!fs.existsSync(file)) {
+      console.warn(`Missing runtime dependency ${line}`)
+      continue
+    }
+    add(file)
+  }
+  return [...files].sort()
+}
+
+// Stores |files| (relative to src) in the objects dir and returns the
+// contents of files.txt.
+const storeObjects = (objectsDir, files) => {
+  fs.ensureDirSync(objectsDir)
+  return files.map((file) => {
+    const source = path.join(config.srcDir, file)
+    const object = objectName(source, fs.statSync(source))
+    const objectFile = path.join(objectsDir, object)
+    if (!fs.existsSync(objectFile)) {
+      fs.copySync(source, objectFile, { preserveTimestamps: true })
+    }
+    return `${object} ${file}\n`
+  }).join('')
+}
+
+// Packages |suite| into a bundle and returns its dir. |tests| are the tests
+// the bundle runs, as listed by the binary.
+const createBundle = (suite, binary, tests, outputDir = config.outputDir) => {
+  const label = suiteLabel(outputDir, suite)
+  const files = runtimeDeps(outputDir, label)
+  const binaryFile = path.relative(config.srcDir, binary).replace(/\\/g, '/')
+  if (!files.includes(binaryFile)) {
+    files.push(binaryFile)
+  }
+  const fileList = storeObjects(path.join(bundlesDir(outputDir), 'objects'), files)
+  const id = crypto.createHash('sha256').update(binaryFile + '\n' + fileList).digest('hex').substring(0, 16)
+  const bundleDir = path.join(bundlesDir(outputDir), `${suite}-${id}`)
+  fs.ensureDirSync(bundleDir)
+  fs.writeFileSync(path.join(bundleDir, 'files.txt'), fileList)
+  fs.writeFileSync(path.join(bundleDir, 'binary.txt'), binaryFile)
+  fs.writeFileSync(path.join(bundleDir, 'tests.txt'), tests.join('\n') + '\n')
+  fs.writeFileSync(path.join(bundleDir, 'run_shard.sh'), runShardScript, { mode: 0o755 })
+  fs.writeJsonSync(path.join(bundleDir, 'manifest.json'), {
+    suite,
+    label,
+    id,
+    binary: binaryFile,
+    files: files.length,
+    testCount: tests.length
+  }, { spaces: 2 })
+  return bundleDir
+}
+
+const readBundle = (bundleDir) => {
+  const manifest = fs.readJsonSync(path.join(bundleDir, 'manifest.json'))
+  manifest.tests = fs.readFileSync(path.join(bundleDir, 'tests.txt'), 'utf8').split('\n').filter((test) => test)
+  return manifest
+}
+
+module.exports = {
+  bundlesDir,
+  hashFile,
+  suiteLabel,
+  runtimeDeps,
+  createBundle,
+  readBundle
+}
@@ -0,0 +1,142 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const crypto = require('crypto')
+const fs = require('fs-extra')
+const config = require('../lib/config')
+const gtestResults = require('./gtestResults')
+const testBundle = require('./testBundle')
+
+// Increment when the key inputs change, so older entries are not served.
+const cacheVersion = 1
+// Passing runs kept per suite.
+const maxEntriesPerSuite = 10
+
+// Arguments which only affect where results go or how fast they are
+// produced, not which tests run or how.
+const isCacheNeutralArg = (arg) => arg.startsWith('--gtest_output=') ||
+  arg.startsWith('--test-launcher-jobs=') || arg.startsWith('--test-launcher-filter-file=')
+
+// Results of passing test runs keyed by the test binary, its runtime_deps and
+// the effective test arguments, kept in |cacheDir|. File hashes are memoized
+// by size and mtime so unchanged runtime_deps are not read again.
+module.exports = class TestCache {
+  constructor (cacheDir, outputDir) {
+    this.cacheDir = cacheDir
+    this.outputDir = outputDir
+    this.hashesFile = path.join(cacheDir, 'file_hashes.json')
+    this.hashes = fs.existsSync(this.hashesFile) ? (fs.readJsonSync(this.hashesFile, { throws: false }) || {}) : {}
+  }
+
+  fileHash (file) {
+    const stat = fs.statSync(file)
+    const known = this.hashes[file]
+    if (known && known.size === stat.size && known.mtime === stat.mtimeMs) {
+      return known.hash
+    }
+    const hash = testBundle.hashFile(file)
+    this.hashes[file] = { size: stat.size, mtime: stat.mtimeMs, hash }
+    return hash
+  }
+
+  // Label of |suite|, looked up with `gn ls` only when gn regenerated the
+  // out dir since the last lookup.
+  suiteLabel (suite) {
+    const labelsFile = path.join(this.cacheDir, 'labels.json')
+    const buildNinja = path.join(this.outputDir, 'build.ninja')
+    const generated = fs.existsSync(buildNinja) ? fs.statSync(buildNinja).mtimeMs : 0
+    const labels = fs.existsSync(labelsFile) ? (fs.readJsonSync(labelsFile, { throws: false }) || {}) : {}
+    let entry = labels[this.outputDir]
+    if (!entry || entry.generated !== generated) {
+      entry = labels[this.outputDir] = { generated, suites: {} }
+    }
+    if (!entry.suites[suite]) {
+      entry.suites[suite] = testBundle.suiteLabel(this.outputDir, suite)
+      fs.ensureDirSync(this.cacheDir)
+      fs.writeJsonSync(labelsFile, labels)
+    }
+    return entry.suites[suite]
+  }
+
+  // Returns null when the inputs cannot be determined.
+  key (suite, binary, args) {
+    if (!fs.existsSync(binary)) {
+      return null
+    }
+    let files
+    try {
+      const label = this.suiteLabel(suite)
+      files = testBundle.runtimeDeps(this.outputDir, label)
+    } catch (e) {
+      console.warn(`Not caching ${suite} results: ${e.message}`)
+      return null
+    }
+    const hash = crypto.createHash('sha256')
+    hash.update(JSON.stringify({
+      cacheVersion,
+      suite,
+      binary: this.fileHash(binary),
+      args: args.filter((arg) => !isCacheNeutralArg(arg))
+    }))
+    for (const file of files) {
+      hash.update(`\n${file} ${this.fileHash(path.join(config.srcDir, file))}`)
+    }
+    fs.ensureDirSync(this.cacheDir)
+    fs.writeJsonSync(this.hashesFile, this.hashes)
+    return hash.digest('hex')
+  }
+
+  entryDir (suite, key) {
+    return path.join(this.cacheDir, suite, key)
+  }
+
+  // Writes the cached results for |key| to |resultsFile|, with every test
+  // marked cached="true". Returns false on a cache miss.
+  restore (suite, key, resultsFile) {
+    const entryDir = this.entryDir(suite, key)
+    const cachedResults = path.join(entryDir, 'results.xml')
+    if (!fs.existsSync(path.join(entryDir, 'passed')) || (resultsFile && !fs.existsSync(cachedResults))) {
+      return false
+    }
+    if (resultsFile) {
+      const tests = gtestResults.read(cachedResults).map((test) =>
+        Object.assign({}, test, { properties: Object.assign({}, test.properties, { cached: 'true' }) }))
+      fs.ensureDirSync(path.dirname(resultsFile))
+      fs.writeFileSync(resultsFile, gtestResults.serialize(tests))
+    }
+    // Keeps recently served entries from being pruned.
+    const now = new Date()
+    fs.utimesSync(entryDir, now, now)
+    return true
+  }
+
+  // Stores a passing run of |key|. Runs in which a test only passed on a
+  // retry are not stored, or the next run would get a cached pass for a
+  // flaky test. Returns whether the run was stored.
+  store (suite, key, resultsFile) {
+    if (resultsFile && fs.existsSync(resultsFile) &&
+        gtestResults.read(resultsFile).some((test) => test.properties.flaky === 'true')) {
+      return false
+    }
+    const entryDir = this.entryDir(suite, key)
+    fs.ensureDirSync(entryDir)
+    if (resultsFile && fs.existsSync(resultsFile)) {
+      fs.copySync(resultsFile, path.join(entryDir, 'results.xml'))
+    }
+    fs.writeFileSync(path.join(entryDir, 'passed'), new Date().toISOString())
+    this.prune(suite)
+    return true
+  }
+
+  prune (suite) {
+    const suiteDir = path.join(this.cacheDir, suite)
+    fs.readdirSync(suiteDir)
+      .map((entry) => ({ entry, mtime: fs.statSync(path.join(suiteDir, entry)).mtimeMs }))
+      .sort((a, b) => b.mtime - a.mtime)
+      .slice(maxEntriesPerSuite)
+      .forEach(({ entry }) => fs.removeSync(path.join(suiteDir, entry)))
+  }
+}
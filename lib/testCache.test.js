@@ -0,0 +1,43 @@
+const path = require('path')
+const os = require('os')
+const fs = require('fs-extra')
+const gtestResults = require('./gtestResults')
+const TestCache = require('./testCache')
+
+test('serves stored passing results marked as cached', function () {
+  const cacheDir = fs.mkdtempSync(path.join(os.tmpdir(), 'test-cache-'))
+  const resultsFile = path.join(cacheDir, 'results.xml')
+  try {
+    const testCache = new TestCache(cacheDir, 'out/Release')
+    fs.writeFileSync(resultsFile, gtestResults.serialize([
+      { suite: 'A', name: 'b', time: 1, status: 'run', result: 'completed', failures: [], properties: {} }
+    ]))
+    expect(testCache.restore('unit', 'key', resultsFile)).toBe(false)
+    testCache.store('unit', 'key', resultsFile)
+    fs.removeSync(resultsFile)
+
+    expect(testCache.restore('unit', 'other', resultsFile)).toBe(false)
+    expect(testCache.restore('unit', 'key', resultsFile)).toBe(true)
+    const tests = gtestResults.read(resultsFile)
+    expect(tests.map(gtestResults.fullName)).toEqual(['A.b'])
+    expect(tests[0].properties.cached).toBe('true')
+  } finally {
+    fs.removeSync(cacheDir)
+  }
+})
+
+test('does not store runs in which a test passed on a retry', function () {
+  const cacheDir = fs.mkdtempSync(path.join(os.tmpdir(), 'test-cache-'))
+  const resultsFile = path.join(cacheDir, 'results.xml')
+  try {
+    const testCache = new TestCache(cacheDir, 'out/Release')
+    fs.writeFileSync(resultsFile, gtestResults.serialize([
+      { suite: 'A', name: 'b', time: 1, status: 'run', result: 'completed', failures: [], properties: {} },
+      { suite: 'A', name: 'c', time: 1, status: 'run', result: 'completed', failures: [], properties: { flaky: 'true', retries: '1' } }
+    ]))
+    expect(testCache.store('unit', 'key', resultsFile)).toBe(false)
+    expect(testCache.restore('unit', 'key', resultsFile)).toBe(false)
+  } finally {
+    fs.removeSync(cacheDir)
+  }
+})
@@ -0,0 +1,112 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const fs = require('fs-extra')
+const config = require('../lib/config')
+const util = require('../lib/util')
+const gtestResults = require('./gtestResults')
+
+// Number of recent runs kept per test in the flakiness history.
+const historyLength = 20
+// Tests which flaked this many times in their recent runs are quarantined.
+const quarantineFlakes = 3
+// More failures than this most likely means a real breakage, so retrying
+// every one of them in isolation would only waste time.
+const maxRetriedFailures = 25
+
+// Per-test flakiness history of a suite, stored as JSON in |historyDir|.
+class FlakinessHistory {
+  constructor (historyDir, suite) {
+    this.file = path.join(historyDir, suite + '.flakiness.json')
+    this.tests = fs.existsSync(this.file) ? (fs.readJsonSync(this.file, { throws: false }) || {}) : {}
+  }
+
+  record (tests) {
+    for (const test of tests) {
+      if (test.status !== 'run') {
+        continue
+      }
+      const name = gtestResults.fullName(test)
+      const recent = (this.tests[name] || []).concat(test.properties.flaky === 'true' ? 1 : 0)
+      this.tests[name] = recent.slice(-historyLength)
+    }
+    fs.ensureDirSync(path.dirname(this.file))
+    fs.writeJsonSync(this.file, this.tests)
+  }
+
+  quarantined () {
+    return Object.keys(this.tests).filter((name) =>
+      this.tests[name].reduce((flakes, flaky) => flakes + flaky, 0) >= quarantineFlakes)
+  }
+}
+
+// Appends negative patterns for |excludedTests| to a gtest filter.
+const excludeFromFilter = (filter, excludedTests) => {
+  if (!excludedTests.length) {
+    return filter
+  }
+  const positive = filter || '*'
+  return positive + (positive.includes('-') ? ':' : '-') + excludedTests.join(':')
+}
+
+// Reruns every failed test of |resultsFile| on its own, in a single process,
+// up to |retries| times. Tests which pass on a retry are reported as passed
+// with flaky="true" in |resultsFile|. Returns whether all tests passed.
+const retryFailures = (binary, args, resultsFile, retries) => {
+  const tests = gtestResults.read(resultsFile)
+  const failed = tests.filter(gtestResults.isFailure)
+  if (!failed.length) {
+    return true
+  }
+  if (failed.length > maxRetriedFailures) {
+    console.log(`${failed.length} tests failed, not retrying more than ${maxRetriedFailures}`)
+    return false
+  }
+
+  const retryArgs = args.filter((arg) => !arg.startsWith('--gtest_filter=') &&
+    !arg.startsWith('--gtest_output=') && !arg.startsWith('--test-launcher-filter-file=') &&
+    !arg.startsWith('--test-launcher-jobs='))
+  const retryResultsFile = resultsFile.replace(/(\.xml)?$/, '.retry.xml')
+  let remaining = 0
+  for (const test of failed) {
+    const name = gtestResults.fullName(test)
+    let passed = false
+    for (let attempt = 1; attempt <= retries && !passed; attempt++) {
+      console.log(`retrying ${name} (${attempt}/${retries})...`)
+      fs.removeSync(retryResultsFile)
+      util.run(binary, [
+        ...retryArgs,
+        '--gtest_filter=' + name,
+        '--single-process-tests',
+        '--gtest_output=xml:' + retryResultsFile
+      ], Object.assign({}, config.defaultOptions, { continueOnFail: true }))
+      const retried = fs.existsSync(retryResultsFile)
+        ? gtestResults.read(retryResultsFile).find((result) => gtestResults.fullName(result) === name)
+        : null
+      if (retried && !gtestResults.isFailure(retried) && retried.status === 'run') {
+        passed = true
+        Object.assign(test, {
+          time: retried.time,
+          failures: [],
+          properties: Object.assign({}, test.properties, { flaky: 'true', retries: String(attempt) })
+        })
+        console.log(`${name} is flaky, it passed on retry ${attempt}`)
+      }
+    }
+    if (!passed) {
+      remaining++
+    }
+  }
+  fs.removeSync(retryResultsFile)
+  fs.writeFileSync(resultsFile, gtestResults.serialize(tests))
+  return remaining === 0
+}
+
+module.exports = {
+  FlakinessHistory,
+  excludeFromFilter,
+  retryFailures
+}
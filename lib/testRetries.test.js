@@ -0,0 +1,29 @@
+const path = require('path')
+const os = require('os')
+const fs = require('fs-extra')
+const { FlakinessHistory, excludeFromFilter } = require('./testRetries')
+
+test('excludes quarantined tests from the filter', function () {
+  expect(excludeFromFilter(null, ['A.b', 'C.d'])).toBe('*-A.b:C.d')
+  expect(excludeFromFilter('A.*', ['A.b'])).toBe('A.*-A.b')
+  expect(excludeFromFilter('A.*-A.c', ['A.b'])).toBe('A.*-A.c:A.b')
+  expect(excludeFromFilter('A.*', [])).toBe('A.*')
+})
+
+test('quarantines tests which flaked repeatedly', function () {
+  const historyDir = fs.mkdtempSync(path.join(os.tmpdir(), 'test-history-'))
+  const run = (flaky) => [
+    { suite: 'A', name: 'flaky', status: 'run', properties: flaky ? { flaky: 'true' } : {} },
+    { suite: 'A', name: 'stable', status: 'run', properties: {} }
+  ]
+  try {
+    for (const flaky of [true, false, true, false]) {
+      new FlakinessHistory(historyDir, 'unit').record(run(flaky))
+    }
+    expect(new FlakinessHistory(historyDir, 'unit').quarantined()).toEqual([])
+    new FlakinessHistory(historyDir, 'unit').record(run(true))
+    expect(new FlakinessHistory(historyDir, 'unit').quarantined()).toEqual(['A.flaky'])
+  } finally {
+    fs.removeSync(historyDir)
+  }
+})
@@ -0,0 +1,153 @@
+const path = require('path')
+const os = require('os')
+const fs = require('fs-extra')
+const { spawn } = require('child_process')
+const config = require('../lib/config')
+const util = require('../lib/util')
+const gtestResults = require('./gtestResults')
+const TestTimings = require('./testTimings')
+const DisplayPool = require('./displayPool')
+
+// Parses `--gtest_list_tests` output:
+//   FooTest.
+//     Bar
+//     Baz  # GetParam() = 1
+// PRE_ tests are run by the launcher together with their main test and
+// disabled tests do not run at all, so both are left out.
+const parseTestList = (output) => {
+  const tests = []
+  let suite = null
+  for (const line of output.split(/\r?\n/)) {
+    const entry = line.split('#')[0].trimRight()
+    if (!entry) {
+      continue
+    }
+    if (!/^\s/.test(entry)) {
+      suite = entry.trim()
+      continue
+    }
+    const name = entry.trim()
+    if (suite && !name.startsWith('PRE_') && !name.startsWith('DISABLED_') &&
+        !suite.startsWith('DISABLED_') && !suite.includes('/DISABLED_')) {
+      tests.push(suite + name)
+    }
+  }
+  return tests
+}
+
+const listTests = (binary, filter) => {
+  const args = ['--gtest_list_tests']
+  if (filter) {
+    args.push('--gtest_filter=' + filter)
+  }
+  const options = Object.assign({}, config.defaultOptions, {
+    stdio: 'pipe',
+    maxBuffer: 256 * 1024 * 1024
+  })
+  return parseTestList(util.run(binary, args, options).stdout.toString())
+}
+
+const shardOutputFile = (output, index) => output.replace(/(\.xml)?$/, `.shard${index}.xml`)
+
+// Args shared by all shards: every shard gets its own filter file and
+// results file instead of --gtest_filter/--gtest_output.
+const shardArgs = (args) => args.filter((arg) =>
+  !arg.startsWith('--gtest_filter=') && !arg.startsWith('--gtest_output='))
+
+const runShard = (binary, args, env) => {
+  return new Promise((resolve) => {
+    const prog = spawn(binary, args, { env, stdio: 'inherit', cwd: config.srcDir })
+    prog.on('close', (statusCode) => resolve(statusCode))
+  })
+}
+
+// Splits |suite| into |options.total_shards| shards balanced with the test
+// durations recorded by previous runs, leaving out |excludedTests|, runs
+// every shard concurrently and merges their results into |output|.
+// With |options.shard_index|, e.g. on one of several CI nodes, only that
+// shard runs. Every node has to compute the same plan, so the durations are
+// then read from |options.shard_timings|, a timings file all nodes share, or
+// else from the test history dir, which the nodes must share. They are not
+// updated by the shard, so nodes starting later still get the same plan.
+const runShards = async (suite, binary, braveArgs, filter, output, excludedTests, options) => {
+  const totalShards = parseInt(options.total_shards, 10)
+  const singleShard = options.shard_index !== undefined
+  const timings = new TestTimings(config.testHistoryDir, suite, singleShard ? options.shard_timings : undefined)
+  const excluded = new Set(excludedTests)
+  let shards
+  let shardIndexes
+  if (singleShard) {
+    if (!fs.existsSync(timings.file)) {
+      console.warn(`${timings.file} does not exist, every test of ${suite} is assumed to take as long`)
+    }
+    // Excluded tests come from the local flakiness history, so they are left
+    // out only after the assignment.
+    shards = timings.shards(listTests(binary, filter), totalShards)
+    shards.forEach((shard) => { shard.tests = shard.tests.filter((test) => !excluded.has(test)) })
+    shardIndexes = [parseInt(options.shard_index, 10)]
+  } else {
+    shards = timings.shards(listTests(binary, filter).filter((test) => !excluded.has(test)), totalShards)
+    shardIndexes = shards.map((shard, index) => index)
+  }
+
+  const args = shardArgs(braveArgs)
+  if (shardIndexes.length > 1 && !options.test_launcher_jobs) {
+    // Shards run side by side, so they split the launcher parallelism.
+    const jobs = Math.max(1, Math.floor(os.cpus().length / shardIndexes.length))
+    args.push('--test-launcher-jobs=' + jobs)
+  }
+
+  const displayPool = options.display_pool
+    ? new DisplayPool(options.display_pool, shardIndexes.length)
+    : null
+  const filterDir = path.join(config.outputDir, 'test_shards')
+  fs.ensureDirSync(filterDir)
+  let statuses
+  try {
+    if (displayPool) {
+      await displayPool.start()
+    }
+    statuses = await Promise.all(shardIndexes.map((index, slot) => {
+      const shard = shards[index]
+      const filterFile = path.join(filterDir, `${suite}.shard${index}.filter`)
+      fs.writeFileSync(filterFile, shard.tests.join('\n') + '\n')
+      console.log(`${suite} shard ${index + 1}/${totalShards}: ${shard.tests.length} tests, ~${Math.round(shard.total)}s`)
+      const shardOutput = shardIndexes.length > 1 ? shardOutputFile(output, index) : output
+      if (!shard.tests.length) {
+        // An empty filter file would run the whole suite.
+        fs.writeFileSync(path.resolve(config.srcDir, shardOutput), gtestResults.serialize([]))
+        return 0
+      }
+      const slotOptions = displayPool
+        ? displayPool.slotOptions(slot, config.defaultOptions.env)
+        : { env: config.defaultOptions.env, args: [] }
+      return runShard(binary, [
+        ...args,
+        ...slotOptions.args,
+        '--test-launcher-filter-file=' + filterFile,
+        '--gtest_output=xml:' + shardOutput
+      ], slotOptions.env)
+    }))
+  } finally {
+    if (displayPool) {
+      displayPool.stop()
+    }
+  }
+
+  if (shardIndexes.length > 1) {
+    const shardOutputs = shardIndexes.map((index) => path.resolve(config.srcDir, shardOutputFile(output, index)))
+    gtestResults.merge(shardOutputs, path.resolve(config.srcDir, output))
+    shardOutputs.forEach((file) => fs.removeSync(file))
+  }
+  if (!singleShard) {
+    timings.recordResults(path.resolve(config.srcDir, output))
+  }
+  return statuses.every((status) => status === 0)
+}
+
+module.exports = {
+  parseTestList,
+  listTests,
+  runShard,
+  runShards
+}
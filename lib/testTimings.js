@@ -0,0 +1,75 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const path = require('path')
+const fs = require('fs-extra')
+const gtestResults = require('./gtestResults')
+
+// Weight of the newest measurement in the moving average of a test duration.
+const smoothing = 0.5
+// Duration assumed for tests without history, in seconds.
+const defaultDuration = 1
+
+// Longest-processing-time-first scheduling: tests are handed out from the
+// slowest to the fastest, each to the shard with the smallest total so far.
+const lptShards = (tests, shardCount, duration) => {
+  const shards = []
+  for (let i = 0; i < shardCount; i++) {
+    shards.push({ tests: [], total: 0 })
+  }
+  const sorted = tests.map((test) => ({ test, duration: duration(test) }))
+    .sort((a, b) => b.duration - a.duration || (a.test < b.test ? -1 : 1))
+  for (const { test, duration } of sorted) {
+    const shard = shards.reduce((min, shard) => shard.total < min.total ? shard : min)
+    shard.tests.push(test)
+    shard.total += duration
+  }
+  return shards
+}
+
+// Per-test durations of a suite, stored as JSON in |historyDir|, or in
+// |file| when given.
+module.exports = class TestTimings {
+  constructor (historyDir, suite, file) {
+    this.file = file ? path.resolve(file) : path.join(historyDir, suite + '.timings.json')
+    this.durations = fs.existsSync(this.file) ? (fs.readJsonSync(this.file, { throws: false }) || {}) : {}
+  }
+
+  // Unknown tests are assumed to take as long as a typical known test.
+  duration (test) {
+    if (test in this.durations) {
+      return this.durations[test]
+    }
+    if (this.medianDuration === undefined) {
+      const known = Object.values(this.durations).sort((a, b) => a - b)
+      this.medianDuration = known.length ? known[Math.floor(known.length / 2)] : defaultDuration
+    }
+    return this.medianDuration
+  }
+
+  recordResults (resultsFile) {
+    if (!fs.existsSync(resultsFile)) {
+      return
+    }
+    for (const test of gtestResults.read(resultsFile)) {
+      if (test.status !== 'run') {
+        continue
+      }
+      const name = gtestResults.fullName(test)
+      this.durations[name] = name in this.durations
+        ? smoothing * test.time + (1 - smoothing) * this.durations[name]
+        : test.time
+    }
+    this.medianDuration = undefined
+    fs.ensureDirSync(path.dirname(this.file))
+    fs.writeJsonSync(this.file, this.durations, { spaces: 1 })
+  }
+
+  shards (tests, shardCount) {
+    return lptShards(tests, shardCount, (test) => this.duration(test))
+  }
+}
+
+module.exports.lptShards = lptShards
@@ -0,0 +1,43 @@
+const path = require('path')
+const os = require('os')
+const fs = require('fs-extra')
+const TestTimings = require('./testTimings')
+const testShards = require('./testShards')
+
+test('balances shards by duration', function () {
+  const durations = { A: 7, B: 5, C: 4, D: 3, E: 2, F: 2 }
+  const shards = TestTimings.lptShards(Object.keys(durations), 2, (test) => durations[test])
+  expect(shards.map((shard) => shard.total)).toEqual([12, 11])
+  expect(shards[0].tests).toEqual(['A', 'D', 'F'])
+  expect(shards[1].tests).toEqual(['B', 'C', 'E'])
+})
+
+test('parses gtest test lists', function () {
+  const tests = testShards.parseTestList([
+    'BraveRewardsTest.',
+    '  PRE_ClaimGrant',
+    '  ClaimGrant',
+    '  DISABLED_Flaky',
+    'All/AdBlockServiceTest.  # TypeParam = int',
+    '  Cosmetic/0  # GetParam() = 1',
+    'DISABLED_Suite.',
+    '  Test',
+    ''
+  ].join('\n'))
+  expect(tests).toEqual(['BraveRewardsTest.ClaimGrant', 'All/AdBlockServiceTest.Cosmetic/0'])
+})
+
+test('plans the same shards from the same timings file', function () {
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'test-timings-'))
+  try {
+    const file = path.join(dir, 'shared.timings.json')
+    fs.writeJsonSync(file, { 'A.a': 9, 'A.b': 1, 'B.a': 4, 'B.b': 4 })
+    const tests = ['A.a', 'A.b', 'B.a', 'B.b', 'C.a']
+    const node1 = new TestTimings(path.join(dir, 'node1'), 'unit', file).shards(tests, 2)
+    const node2 = new TestTimings(path.join(dir, 'node2'), 'unit', file).shards(tests.slice().reverse(), 2)
+    expect(node2).toEqual(node1)
+    expect(node1.map((shard) => shard.tests)).toEqual([['A.a', 'A.b'], ['B.a', 'B.b', 'C.a']])
+  } finally {
+    fs.removeSync(dir)
+  }
+})
@@ -0,0 +1,96 @@
+// Copyright (c) 2019 The Brave Authors. All rights reserved.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this file,
+// you can obtain one at http://mozilla.org/MPL/2.0/.
+
+const ip = require('ip')
+const URL = require('url').URL
+
+// Bounds the memory of the per URL verdict cache on very long audits.
+const maxCachedUrls = 100000
+
+// Prefix tree of whitelisted URL prefixes: a lookup walks the URL once
+// instead of comparing it with every prefix.
+class PrefixTrie {
+  constructor (prefixes) {
+    this.root = new Map()
+    for (const prefix of prefixes) {
+      let node = this.root
+      for (const c of prefix) {
+        if (!node.has(c)) {
+          node.set(c, new Map())
+        }
+        node = node.get(c)
+      }
+      node.terminal = true
+    }
+  }
+
+  hasPrefixOf (url) {
+    let node = this.root
+    for (let i = 0; i < url.length; i++) {
+      node = node.get(url[i])
+      if (!node) {
+        return false
+      }
+      if (node.terminal) {
+        return true
+      }
+    }
+    return false
+  }
+}
+
+// Classifies the URLs requested during the network audit:
+//   'ignored'   non network protocols and unresolvable single label hosts
+//   'allowed'   whitelisted by prefix or pattern
+//   'private'   not whitelisted, but to a private IP
+//   'blocked'   anything else
+// The prefixes are compiled into a trie and the patterns into one anchored
+// regex once, and verdicts are cached per distinct URL since the same
+// URLs show up in many events.
+module.exports = class UrlWhitelist {
+  constructor (prefixes, patterns, protocols) {
+    this.prefixes = new PrefixTrie(prefixes)
+    this.patterns = patterns.length ? new RegExp('^(?:' + patterns.join('|') + ')') : null
+    this.protocols = new Set(protocols)
+    this.verdicts = new Map()
+  }
+
+  isWhitelisted (url) {
+    return this.prefixes.hasPrefixOf(url) || (this.patterns !== null && this.patterns.test(url))
+  }
+
+  classify (url) {
+    const urlParsed = new URL(url)
+    const hostname = urlParsed.hostname
+    if (/^[a-z]+$/.test(hostname)) {
+      // Chromium sometimes sends requests to random non-resolvable hosts
+      return 'ignored'
+    }
+    if (this.protocols.has(urlParsed.protocol)) {
+      return 'ignored'
+    }
+    if (this.isWhitelisted(url)) {
+      return 'allowed'
+    }
+    try {
+      if (ip.isPrivate(hostname)) {
+        return 'private'
+      }
+    } catch (e) {}
+    return 'blocked'
+  }
+
+  check (url) {
+    let verdict = this.verdicts.get(url)
+    if (verdict === undefined) {
+      verdict = this.classify(url)
+      if (this.verdicts.size >= maxCachedUrls) {
+        this.verdicts.clear()
+      }
+      this.verdicts.set(url, verdict)
+    }
+    return verdict
+  }
+}
@@ -0,0 +1,18 @@
+const UrlWhitelist = require('./urlWhitelist')
+
+test('classifies URLs with the compiled prefixes and patterns', function () {
+  const whitelist = new UrlWhitelist(
+    ['https://go-updater.brave.com/', 'https://go-updater.brave.com/extensions/x', 'http://dl.google.com/release2/'],
+    ['https://[a-z0-9-\\.]+\\.gvt1\\.com/edgedl/.+', 'http://example\\.com/a+$'],
+    ['chrome:', 'data:'])
+  expect(whitelist.check('https://go-updater.brave.com/extensions')).toBe('allowed')
+  expect(whitelist.check('https://go-updater.brave.co/')).toBe('blocked')
+  expect(whitelist.check('http://dl.google.com/release2/crl')).toBe('allowed')
+  expect(whitelist.check('https://r1.gvt1.com/edgedl/crx')).toBe('allowed')
+  expect(whitelist.check('https://gvt1.com/edgedl/crx')).toBe('blocked')
+  expect(whitelist.check('http://example.com/aaa')).toBe('allowed')
+  expect(whitelist.check('http://example.com/aab')).toBe('blocked')
+  expect(whitelist.check('http://192.168.0.1/')).toBe('private')
+  expect(whitelist.check('chrome://newtab/')).toBe('ignored')
+  expect(whitelist.check('https://randomhost/')).toBe('ignored')
+})
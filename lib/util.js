@@ -3,6 +3,7 @@ const { spawn, spawnSync } = require('child_process')
 const config = require('./config')
 const fs = require('fs-extra')
 const crypto = require('crypto')
+const buildExecutors = require('./buildExecutors')
 const autoGeneratedBraveToChromiumMapping = Object.assign({}, require('./l10nUtil').autoGeneratedBraveToChromiumMapping)
 const os = require('os')
 
@@ -402,25 +403,44 @@ const util = {
         '--private_key_passphrase=' + passwd])
   },
 
-  buildTarget: (options = config.defaultOptions) => {
-    console.log('building ' + config.buildTarget + '...')
-
+  generateNinjaFiles: (options = config.defaultOptions) => {
     if (process.platform === 'win32') util.updateOmahaMidlFiles()
     if (process.platform === 'linux') util.prepareWidevineCdmBuild()
 
+    const args = util.buildArgsToString(config.buildArgs())
+    util.run('gn', ['gen', config.outputDir, '--args="' + args + '"'], options)
+
+    if (config.buildGraphIndex) {
+      // Required here because buildGraph itself depends on util.
+      const BuildGraph = require('./buildGraph')
+      new BuildGraph(config.outputDir).update()
+    }
+  },
+
+  getNinjaOpts: () => {
     let num_compile_failure = 1
     if (config.ignore_compile_failure)
       num_compile_failure = 0
 
-    const args = util.buildArgsToString(config.buildArgs())
-    util.run('gn', ['gen', config.outputDir, '--args="' + args + '"'], options)
-
-    let ninjaOpts = [
+    return [
       '-C', config.outputDir, config.buildTarget,
       '-k', num_compile_failure,
       ...config.extraNinjaOpts
     ]
-    util.run('ninja', ninjaOpts, options)
+  },
+
+  buildTarget: (options = config.defaultOptions) => {
+    console.log('building ' + config.buildTarget + '...')
+
+    util.generateNinjaFiles(options)
+    util.runBuildExecutor(util.getNinjaOpts(), options)
+  },
+
+  runBuildExecutor: (ninjaOpts, options = config.defaultOptions) => {
+    const executor = buildExecutors.getExecutor(config.buildExecutor)
+    const prog = util.run(executor.binary, executor.translateArgs(ninjaOpts), options)
+    executor.normalizeLog(config.outputDir)
+    return prog
   },
 
   generateXcodeWorkspace: (options = config.defaultOptions) => {
@@ -0,0 +1,102 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Replays the URL requests of a recorded NetLog through the network audit
+// whitelist, comparing the compiled matcher with the previous linear scan.
+// Usage: npm run benchmark_network_audit -- [network_log.json] [--repeat=N]
+
+const path = require('path')
+const URL = require('url').URL
+const ip = require('ip')
+const NetLogParser = require('../lib/netLogParser')
+const { NetworkAudit } = require('../lib/networkAudit')
+const UrlWhitelist = require('../lib/urlWhitelist')
+const whitelistedUrlPrefixes = require('../lib/whitelistedUrlPrefixes')
+const whitelistedUrlPatterns = require('../lib/whitelistedUrlPatterns')
+
+const protocols = ['chrome-extension:', 'chrome:', 'brave:', 'file:', 'data:', 'blob:']
+
+// The matcher the audit used before the whitelist was compiled.
+const linearScan = (url) => {
+  const urlParsed = new URL(url)
+  const hostname = urlParsed.hostname
+  if (/^[a-z]+$/.test(hostname) || protocols.includes(urlParsed.protocol)) {
+    return 'ignored'
+  }
+  const foundPrefix = whitelistedUrlPrefixes.find((prefix) => url.startsWith(prefix))
+  const foundPattern = whitelistedUrlPatterns.find((pattern) => RegExp('^' + pattern).test(url))
+  if (foundPrefix || foundPattern) {
+    return 'allowed'
+  }
+  try {
+    if (ip.isPrivate(hostname)) {
+      return 'private'
+    }
+  } catch (e) {}
+  return 'blocked'
+}
+
+const time = (fn) => {
+  const start = process.hrtime.bigint()
+  const result = fn()
+  return { result, ms: Number(process.hrtime.bigint() - start) / 1e6 }
+}
+
+const main = async () => {
+  const args = process.argv.slice(2)
+  const repeatArg = args.find((arg) => arg.startsWith('--repeat='))
+  const repeat = repeatArg ? parseInt(repeatArg.split('=')[1], 10) : 1
+  const networkLogFile = path.resolve(args.find((arg) => !arg.startsWith('--')) ||
+    path.join(__dirname, '..', 'network_log.json'))
+
+  const urls = []
+  const audit = new NetworkAudit(() => {})
+  const parseStart = process.hrtime.bigint()
+  const parser = await NetLogParser.parseFile(networkLogFile, (constants) => audit.setConstants(constants), (event) => {
+    if (event.source.type === audit.URL_REQUEST_TYPE && event.params && event.params.url) {
+      urls.push(event.params.url)
+    }
+  })
+  const parseMs = Number(process.hrtime.bigint() - parseStart) / 1e6
+  console.log(`parsed ${parser.eventCount} events (${urls.length} with URLs) in ${parseMs.toFixed(0)}ms`)
+  if (!urls.length) {
+    console.log('no URL requests to replay')
+    return
+  }
+
+  const replay = (check) => {
+    const verdicts = {}
+    for (let i = 0; i < repeat; i++) {
+      for (const url of urls) {
+        const verdict = check(url)
+        verdicts[verdict] = (verdicts[verdict] || 0) + 1
+      }
+    }
+    return verdicts
+  }
+  const events = urls.length * repeat
+  const whitelist = new UrlWhitelist(whitelistedUrlPrefixes, whitelistedUrlPatterns, protocols)
+  const linear = time(() => replay(linearScan))
+  const compiled = time(() => replay((url) => whitelist.check(url)))
+  for (const [name, run] of [['linear scan', linear], ['compiled', compiled]]) {
+    console.log(`${name}: ${events} URLs in ${run.ms.toFixed(0)}ms, ${(events / run.ms * 1000).toFixed(0)} URLs/s`)
+  }
+  console.log(`speedup: ${(linear.ms / compiled.ms).toFixed(1)}x`)
+  // Equal verdict counts do not rule out two matchers swapping verdicts
+  // between URLs, so every URL is checked once more outside the timing.
+  const mismatch = urls.find((url) => linearScan(url) !== whitelist.check(url))
+  if (mismatch) {
+    console.error(`verdicts differ for ${mismatch}: linear scan ${linearScan(mismatch)}, compiled ${whitelist.check(mismatch)}`)
+    process.exit(1)
+  }
+  if (JSON.stringify(linear.result) !== JSON.stringify(compiled.result)) {
+    console.error('verdict counts differ:', linear.result, compiled.result)
+    process.exit(1)
+  }
+}
+
+main().catch((e) => {
+  console.error(e)
+  process.exit(1)
+})
@@ -17,6 +17,13 @@ const chromiumRebaseL10n = require('../lib/chromiumRebaseL10n')
 const createDist = require('../lib/createDist')
 const upload = require('../lib/upload')
 const test = require('../lib/test')
+const gcOut = require('../lib/gcOut')
+const graph = require('../lib/graph')
+const packageTests = require('../lib/packageTests')
+const runTestBundle = require('../lib/runTestBundle')
+const seedProfile = require('../lib/seedProfile')
+const pgo = require('../lib/pgo')
+const sizeReport = require('../lib/sizeReport')
 
 const collect = (value, accumulator) => {
   accumulator.push(value)
@@ -52,9 +59,33 @@ program
   .option('--xcode_gen <target>', 'Generate an Xcode workspace ("ios" or a list of semi-colon separated label patterns, run `gn help label_pattern` for more info.')
   .option('--gn <arg>', 'Additional gn args, in the form <key>:<value>', collect, [])
   .option('--ninja <opt>', 'Additional Ninja command-line options, in the form <key>:<value>', collect, [])
+  .option('--targets <targets>', 'build several targets concurrently, in the form <target_os>:<target_arch>[,...]')
+  .option('--jobs <jobs>', 'total number of jobs shared by all --targets builds')
+  .option('--executor <executor>', 'ninja-compatible build executor to use (ninja, n2, samu, siso)')
+  .option('--compare_executors <executors>', 'after building, compare null and incremental build times of a comma separated list of executors')
+  .option('--compare_runs <runs>', 'number of null builds per executor for --compare_executors', '3')
+  .option('--touch <file>', 'file (relative to src/) touched for the --compare_executors incremental build')
+  .option('--graph_index', 'maintain the build graph index used by `graph` after gn gen')
+  .option('--pgo_profile <file>', 'optimize with this sample profile of `npm run pgo` (clang_sample_profile_path)')
+  .option('--bolt', 'profile brave on a standard workload and optimize it with BOLT after the link, see lib/bolt.js (Linux)')
+  .option('--bolt_runs <runs>', 'with --bolt, startups and page load runs of the before and after benchmark', '5')
+  .option('--page_corpus <dir>', 'with --bolt, the pages of the workload instead of synthetic ones, see lib/replayServer.js')
   .arguments('[build_config]')
   .action(build)
 
+program
+  .command('pgo')
+  .description('profile brave with perf on a fixed workload and rebuild it with the sample profile (AutoFDO, Linux)')
+  .option('-C <build_dir>', 'build config (out/Debug, out/Release')
+  .option('--target_arch <target_arch>', 'target architecture', 'x64')
+  .option('--official_build <official_build>', 'force official build settings')
+  .option('--gn <arg>', 'Additional gn args, in the form <key>:<value>', collect, [])
+  .option('--ninja <opt>', 'Additional Ninja command-line options, in the form <key>:<value>', collect, [])
+  .option('--page_corpus <dir>', 'train on the pages of this corpus instead of synthetic ones, see lib/replayServer.js')
+  .option('--force_training', 'train a new profile even if the one of this version is current')
+  .arguments('[build_config]')
+  .action(pgo)
+
 program
   .command('create_dist')
   .option('-C <build_dir>', 'build config (out/Debug, out/Release')
@@ -71,6 +102,8 @@ program
   .option('--build_omaha', 'build omaha stub/standalone installer')
   .option('--tag_ap <ap>', 'ap for stub/standalone installer')
   .option('--skip_signing', 'skip signing dmg/brave_installer.exe')
+  .option('--executor <executor>', 'ninja-compatible build executor to use (ninja, n2, samu, siso)')
+  .option('--bolt', 'package the brave.bolt of `build --bolt` as brave; brave must not have been linked again since')
   .arguments('[build_config]')
   .action(createDist)
 
@@ -103,10 +136,38 @@ program
   .option('--brave_ads_debug', 'ads debug')
   .option('--single_process', 'use a single process')
   .option('--network_log', 'log network activity to network_log.json')
+  .option('--network_log_warmup <seconds>', 'with --network_log, run for at least <seconds>', '30')
+  .option('--network_log_quiet_period <seconds>', 'with --network_log, quit Brave once no new URL requests appeared for <seconds>', '15')
+  .option('--scenarios <scenarios>', 'with --network_log, audit these scenarios (comma separated, or all) concurrently, see lib/networkAuditScenarios.js')
   .option('--output_path [pathname]', 'use the Brave binary located at [pathname]')
+  .option('--bench_startup <runs>', 'launch Brave <runs> times with cold and warm caches and report startup trace percentiles')
+  .option('--bench_components <runs>', 'measure startup and memory <runs> times per combination of the component toggles and attribute each component\'s cost (Linux)')
+  .option('--component_matrix <matrix>', 'with --bench_components, one_at_a_time (baseline, each component alone, all) or full', 'one_at_a_time')
+  .option('--settle_seconds <seconds>', 'with --bench_components, wait <seconds> after startup before sampling memory', '15')
+  .option('--bench_page_load <runs>', 'load the pages of --page_corpus <runs> times with shields on and off from a local replay server and report their metrics with confidence intervals')
+  .option('--page_corpus <dir>', 'page corpus directory of --bench_page_load, --soak and --profile_heap, see lib/replayServer.js')
+  .option('--record_corpus', 'record the pages listed in --page_corpus from the network into it')
+  .option('--soak <hours>', 'keep Brave navigating and opening and closing tabs for <hours> and fail if its memory or handles keep growing (Linux)')
+  .option('--soak_sample_interval <minutes>', 'with --soak, sample memory every <minutes>', '5')
+  .option('--soak_max_growth <mb_per_hour>', 'with --soak, fail if private memory grows faster than <mb_per_hour>', '20')
+  .option('--profile_cpu', 'run Brave under perf record and write per-process flame graphs to cpu_profile/ (Linux)')
+  .option('--profile_heap', 'dump the heaps of all processes with out-of-process heap profiling at scripted points and report the top allocation sites in brave/ to heap_profile/ (Linux)')
+  .option('--heap_sampling_rate <bytes>', 'with --profile_heap, sample one allocation every <bytes> allocated on average', '100000')
+  .option('--bench_profile <user_data_dir>', 'start benchmarks from a copy of this profile instead of a fresh one')
+  .option('--bench_output <file>', 'where benchmarks write their JSON report')
   .arguments('[build_config]')
   .action(start.bind(null, parsedArgs.unknown))
 
+program
+  .command('seed_profile')
+  .description('generate a deterministic profile with production-scale history, bookmarks and Brave Rewards data')
+  .option('--size <size>', 'profile size preset (small, medium or large)', 'medium')
+  .option('--seed <seed>', 'seed of the generated data', '1')
+  .option('--user_data_dir_name [base_name]', 'user data directory base name, brave-seed-<size> by default')
+  .option('--output_path [pathname]', 'use the Brave binary located at [pathname]')
+  .arguments('[build_config]')
+  .action(seedProfile)
+
 program
   .command('pull_l10n')
   .option('--extension <extension>', 'Scope this command to localize a Brave extension such as ethereum-remote-client')
@@ -141,11 +202,69 @@ program
   .option('--disable_brave_extension', 'disable loading the Brave extension')
   .option('--single_process', 'uses a single process to run tests to help with debugging')
   .option('--test_launcher_jobs <test_launcher_jobs>', 'Number of jobs to launch')
+  .option('--total_shards <total_shards>', 'split the suite into shards balanced by recorded test durations')
+  .option('--shard_index <shard_index>', 'only run this shard of --total_shards (0-based), otherwise all shards run concurrently')
+  .option('--shard_timings <file>', 'with --shard_index, the test durations every machine plans the shards with, e.g. a committed copy of <suite>.timings.json (default: the test history dir, which the machines must then share)')
+  .option('--display_pool <xvfb|ozone>', 'run shards concurrently, each with its own headless display and temp dir (Linux, xvfb needs Xvfb installed)')
+  .option('--retry_failures <retries>', 'rerun each failed test on its own up to <retries> times, reporting tests which then pass as flaky')
+  .option('--quarantine_flaky', 'run tests which flaked repeatedly in recent runs separately; they only fail the suite when they fail on every retry')
+  .option('--no_test_cache', 'run the tests even when their binary, runtime_deps and arguments are unchanged since a passing run')
   .option('--target_os <target_os>', 'target OS')
   .option('--target_arch <target_arch>', 'target architecture', 'x64')
+  .option('--affected', 'only build and run tests affected by brave-core changes since --base')
+  .option('--base <base branch>', 'base branch for --affected', 'origin/master')
   .arguments('[build_config]')
   .action(test)
 
+program
+  .command('package_tests <suite>')
+  .description('package a test suite and its runtime_deps into a bundle which runs without a checkout')
+  .option('--filter <filter>', 'only package the tests matching <filter>')
+  .option('--target_arch <target_arch>', 'target architecture', 'x64')
+  .arguments('[build_config]')
+  .action(packageTests)
+
+program
+  .command('run_test_bundle <bundle_dir>')
+  .description('run the shards of a test bundle on other hosts or in containers and merge their results')
+  .option('--hosts <hosts>', 'comma separated ssh hosts, one shard runs on each')
+  .option('--remote_dir <remote_dir>', 'where bundles are synced to on --hosts', '/tmp/brave-test-bundles')
+  .option('--containers <count>', 'run <count> shards in local containers instead')
+  .option('--image <image>', 'container image for --containers')
+  .option('--output <output>', 'merged test results file path')
+  .option('--v [log_level]', 'set log level to [log_level]', parseInt, '0')
+  .action(runTestBundle)
+
+program
+  .command('gc_out')
+  .option('-C <build_dir>', 'build config (out/Debug, out/Release')
+  .option('--target_os <target_os>', 'target OS')
+  .option('--target_arch <target_arch>', 'target architecture', 'x64')
+  .option('--all', 'remove stale outputs from every out dir, not only the selected one')
+  .option('--disk_budget <size>', 'evict least recently used out dirs and compile cache entries beyond <size> (e.g. 300G)')
+  .option('--dry_run', 'only report what would be removed')
+  .arguments('[build_config]')
+  .action(gcOut)
+
+program
+  .command('graph <query> [items...]')
+  .description('query the build graph index: files, rdeps, deps or tests of files/labels, or update')
+  .option('-C <build_dir>', 'build config (out/Debug, out/Release')
+  .option('--build_config <build_config>', 'build config (Debug, Release)')
+  .option('--target_os <target_os>', 'target OS')
+  .option('--target_arch <target_arch>', 'target architecture', 'x64')
+  .option('--json', 'print results as JSON')
+  .action(graph)
+
+program
+  .command('size_report <out_dir>')
+  .description('break down the size of brave, the .pak files and the shared libraries of <out_dir> by symbol, source directory and brave/ component')
+  .option('--baseline <out_dir>', 'out dir of a build to diff against')
+  .option('--budget <file>', 'JSON size budget to check, exits with 1 when it is exceeded')
+  .option('--top <n>', 'number of symbols and changes to list', '50')
+  .option('--output <file>', 'where to write the report', 'size-report.json')
+  .action(sizeReport)
+
 program
   .command('lint')
   .option('--base <base branch>', 'set the destination branch for the PR')
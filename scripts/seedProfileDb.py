@@ -0,0 +1,27 @@
+#!/usr/bin/env python
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this file,
+# You can obtain one at http://mozilla.org/MPL/2.0/.
+
+"""Runs the SQL statements read from stdin on a SQLite database in a single
+transaction. Used by `npm run seed_profile` to fill the databases of a
+profile, since node has no SQLite module."""
+
+import sqlite3
+import sys
+
+
+def main():
+  if len(sys.argv) != 2:
+    sys.stderr.write('usage: seedProfileDb.py <database>\n')
+    return 1
+  db = sqlite3.connect(sys.argv[1])
+  try:
+    db.executescript('BEGIN;\n' + sys.stdin.read() + '\nCOMMIT;')
+  finally:
+    db.close()
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())